@@ -0,0 +1,108 @@
+/*
+ * Convert breakpoint files between the text and binary formats
+ * Usage: brkconv [-t] [-f] [-d] infile outfile
+ * -t: write text, otherwise binary
+ * -f: store floats instead of doubles
+ * -d: delta-encode times, which may move each time by one ulp
+ */
+#include "breakpoints.h"
+
+enum
+{
+    ARG_PROGNAME,
+    ARG_INFILE,
+    ARG_OUTFILE,
+    ARG_NARGS
+};
+
+int main(int argc, char *argv[])
+{
+    int error = 0;
+    FILE *in_file = NULL, *out_file = NULL;
+    BREAKPOINT *points = NULL;
+    size_t npoints = 0;
+    bool text = false;
+    unsigned flags = 0;
+
+    printf("brkconv: convert breakpoint files between text and binary\n");
+
+    // Get command line flags
+    while (argc > 1 && argv[1][0] == '-')
+    {
+        switch (argv[1][1])
+        {
+        case 't':
+            text = true;
+            break;
+        case 'f':
+            flags |= BRKBIN_FLOAT32;
+            break;
+        case 'd':
+            flags |= BRKBIN_DELTA;
+            break;
+        default:
+            printf("Error: unknown flag %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        argc--;
+        argv++;
+    }
+
+    if (argc < ARG_NARGS)
+    {
+        printf("Insufficient arguments\nUsage: brkconv [-t] [-f] [-d] infile "
+               "outfile\ninfile is a text or binary breakpoint file\n-t:\t"
+               "write text, otherwise binary\n-f:\tstore floats instead of "
+               "doubles\n-d:\tdelta-encode times, which may move each time "
+               "by one ulp\n");
+        return EXIT_FAILURE;
+    }
+    if (text && flags)
+    {
+        printf("Error: -f and -d apply to binary output only\n");
+        return EXIT_FAILURE;
+    }
+
+    in_file = fopen(argv[ARG_INFILE], "rb");
+    if (in_file == NULL)
+    {
+        printf("Error: unable to open file %s\n", argv[ARG_INFILE]);
+        error++;
+        goto cleanup;
+    }
+    points = get_breakpoints(in_file, &npoints);
+    if (points == NULL)
+    {
+        printf("No breakpoints read\n");
+        error++;
+        goto cleanup;
+    }
+
+    out_file = fopen(argv[ARG_OUTFILE], text ? "w" : "wb");
+    if (out_file == NULL)
+    {
+        printf("Error: unable to open output file %s\n", argv[ARG_OUTFILE]);
+        error++;
+        goto cleanup;
+    }
+    if ((text ? write_breakpoints_text(out_file, points, npoints)
+              : write_breakpoints_binary(out_file, points, npoints, flags)))
+    {
+        printf("Error: failed to write to output file %s\n",
+               argv[ARG_OUTFILE]);
+        error++;
+        goto cleanup;
+    }
+    printf("%zu breakpoints written to %s\n", npoints, argv[ARG_OUTFILE]);
+
+cleanup:
+    if (in_file)
+        fclose(in_file);
+    if (out_file && fclose(out_file))
+    {
+        printf("Error: failed to close output file %s\n", argv[ARG_OUTFILE]);
+        error++;
+    }
+    free(points);
+    return error;
+}
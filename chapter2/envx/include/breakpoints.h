@@ -0,0 +1,86 @@
+#pragma once
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Breakpoint files are text, a "time value" pair per line, or binary. The
+ * binary format is loaded without parsing, native byte order:
+ *     char     magic[4]   "BRKB"
+ *     uint32_t version    BRKBIN_VERSION
+ *     uint32_t flags      BRKBIN_FLAGS
+ *     uint32_t reserved   0
+ *     uint64_t npoints
+ *     npoints time, value pairs, doubles or floats
+ * With BRKBIN_DELTA every time is stored as the difference to the previous
+ * one. The difference is rounded, so a time read back may be off by one ulp,
+ * even with doubles; the errors do not accumulate. Binary files are read only
+ * from regular files.
+ */
+
+#define BRKBIN_VERSION 1
+
+typedef enum brkbin_flags
+{
+    BRKBIN_FLOAT32 = 1, // Pairs of floats, otherwise doubles
+    BRKBIN_DELTA = 2    // Times delta-encoded
+} BRKBIN_FLAGS;
+
+typedef struct breakpoint
+{
+    double time, value;
+} BREAKPOINT;
+
+typedef struct min_max_pair
+{
+    double min_val, max_val;
+} MINMAX_PAIR;
+
+/*
+ * Position in a breakpoint array for looking up values at arbitrary times.
+ * Every reader keeps a cursor of its own, so any number of them can share
+ * the same points.
+ */
+typedef struct brk_cursor
+{
+    const BREAKPOINT *points;
+    size_t npoints;
+    size_t index; // Right point of the current span
+} BRKCURSOR;
+
+typedef struct breakpoint_stream
+{
+    BREAKPOINT *points;
+    BREAKPOINT leftpoint, rightpoint;
+    unsigned long npoints;
+    double curpos;
+    double incr;
+    double width, height;
+    unsigned long ileft, iright;
+    int more_points;
+    void *mapping; // Binary file the points are in, or NULL if allocated
+    size_t mapped_size;
+} BRKSTREAM;
+
+BREAKPOINT *get_breakpoints(FILE *fp, size_t *psize);
+int write_breakpoints_text(FILE *fp, const BREAKPOINT *points, size_t npoints);
+int write_breakpoints_binary(FILE *fp, const BREAKPOINT *points,
+                             size_t npoints, unsigned flags);
+bool in_range(const BREAKPOINT *points, double min_val, double max_val,
+              size_t size);
+double val_at_brktime(const BREAKPOINT *points, size_t npoints, double time);
+void brkcursor_init(BRKCURSOR *cursor, const BREAKPOINT *points,
+                    size_t npoints);
+double brkcursor_step(BRKCURSOR *cursor, double time);
+double brkcursor_seek(BRKCURSOR *cursor, double time);
+MINMAX_PAIR get_minmax(const BREAKPOINT *points, size_t size);
+BRKSTREAM *bps_newstream(FILE *file, unsigned long srate, unsigned long *size);
+void bps_init(BRKSTREAM *stream, BREAKPOINT *points, size_t npoints,
+              size_t srate);
+void bps_freepoints(BRKSTREAM *stream);
+double bps_tick(BRKSTREAM *stream);
+void bps_fill(BRKSTREAM *stream, double *out, size_t n);
+void bps_seek(BRKSTREAM *stream, double time);
+void bps_clone(BRKSTREAM *clone, const BRKSTREAM *stream);
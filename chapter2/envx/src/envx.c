@@ -2,6 +2,7 @@
  * Extract an amplitude envelope from a mono sound file
  */
 
+#include "breakpoints.h"
 #include "portsf.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -41,6 +42,9 @@ int main(int argc, char *argv[])
     float *inframe = NULL;
     FILE *out_file = NULL;
     double window_duration = DEFAULT_WINDOW_MSECS;
+    bool binary = false;       // Write the binary breakpoint format
+    BREAKPOINT *points = NULL; // Envelope, collected for binary output
+    size_t points_size = 0;
 
     printf("enx: extract an amplitude envelope from a mono sound file.\n");
 
@@ -61,6 +65,9 @@ int main(int argc, char *argv[])
                     return EXIT_FAILURE;
                 }
                 break;
+            case 'b':
+                binary = true;
+                break;
 
             default:
                 break;
@@ -72,11 +79,12 @@ int main(int argc, char *argv[])
 
     if (argc < ARG_NARGS)
     {
-        printf("Insufficient arguments\nUsage: envx [-wN] infile "
+        printf("Insufficient arguments\nUsage: envx [-wN] [-b] infile "
                "outfile\ninfile is "
                "a soundfile, extracted breakpoints will be output to outfile "
                "in plain text\n\t-wN: set extraction window size to N "
-               "milliseconds (defualt 15)\n");
+               "milliseconds (defualt 15)\n\t-b: write the binary breakpoint "
+               "format instead of text\n");
         return EXIT_FAILURE;
     }
 
@@ -96,7 +104,7 @@ int main(int argc, char *argv[])
     }
 
     // Create breakpoint output file
-    out_file = fopen(argv[ARG_OUTFILE], "w");
+    out_file = fopen(argv[ARG_OUTFILE], binary ? "wb" : "w");
     if (!out_file)
     {
         printf("Error: unable to open output file %s\n", argv[ARG_OUTFILE]);
@@ -121,7 +129,25 @@ int main(int argc, char *argv[])
     while ((frames_read = psf_sndReadFloatFrames(ifd, inframe, window_size)) > 0)
     {
         double amp = sample_peak(inframe, window_size);
-        if (fprintf(out_file, "%f\t%f\n", breakpoint_time, amp) < 2)
+        if (binary)
+        {
+            // Written at once when the number of points is known
+            if (npoints == points_size)
+            {
+                points_size = points_size ? 2 * points_size : 1024;
+                BREAKPOINT *tmp =
+                    realloc(points, points_size * sizeof(BREAKPOINT));
+                if (!tmp)
+                {
+                    printf("Error: no memory\n");
+                    error++;
+                    goto cleanup;
+                }
+                points = tmp;
+            }
+            points[npoints] = (BREAKPOINT){breakpoint_time, amp};
+        }
+        else if (fprintf(out_file, "%f\t%f\n", breakpoint_time, amp) < 2)
         {
             printf("Error: failed to write to output file%s\n",
                    argv[ARG_OUTFILE]);
@@ -132,6 +158,14 @@ int main(int argc, char *argv[])
         npoints++;
     }
 
+    if (binary && frames_read >= 0 &&
+        write_breakpoints_binary(out_file, points, npoints, 0))
+    {
+        printf("Error: failed to write to output file%s\n", argv[ARG_OUTFILE]);
+        error++;
+        goto cleanup;
+    }
+
     if (frames_read < 0)
     {
         printf("Error reading infile. Output file is incomplete\n");
@@ -152,5 +186,6 @@ cleanup:
             printf("Error: failed to close output file%s\n", argv[ARG_OUTFILE]);
     if (inframe)
         free(inframe);
+    free(points);
     return error;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <stddef.h>
+
+/*
+ * DSP kernels shared by the tools, with scalar, SSE2, AVX2 and AVX-512
+ * implementations. The tools are built without -march, so the vector
+ * versions are compiled for their instruction sets function by function and
+ * the fastest set the CPU supports is picked at startup. Every set gives
+ * bit-identical results, so the choice only affects speed.
+ */
+
+typedef enum kernel_level
+{
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    KERNEL_NLEVELS
+} KERNEL_LEVEL;
+
+typedef struct kernels
+{
+    const char *name; // Name accepted by --kernel
+    // buf[i] *= gain
+    void (*gain)(float *buf, float gain, size_t n);
+    // buf[i] *= env[i], multiplied in double precision
+    void (*envelope)(float *buf, const double *env, size_t n);
+    // Largest absolute value in buf, 0 if n is 0
+    float (*peak)(const float *buf, size_t n);
+    // out[i] = scale * in[i], rounded to float
+    void (*convert)(float *out, const double *in, double scale, size_t n);
+    // out[i] = sine of phases[i] in [0, 2pi) by an odd minimax polynomial of
+    // degree 9, max error 3.4e-9
+    void (*sine)(float *out, const double *phases, size_t n);
+} KERNELS;
+
+/*
+ * The selected kernels. Unless kernels_select was called, the best level the
+ * CPU supports is detected on the first call.
+ */
+const KERNELS *kernels(void);
+
+// Kernels of level, or NULL if the CPU does not support it
+const KERNELS *kernels_level(KERNEL_LEVEL level);
+
+// Select the kernels named name. Returns 0 on success.
+int kernels_select(const char *name);
+
+/*
+ * Handle a "--kernel name" or "--kernel=name" option anywhere in argv: select
+ * the kernels and remove the option from argv, decrementing *argc. Prints an
+ * error and returns -1 if name is unknown or unsupported, otherwise 0.
+ */
+int kernels_args(int *argc, char *argv[]);
@@ -0,0 +1,92 @@
+/*
+ * Benchmark of the kernel levels this CPU supports. Checks that every level
+ * gives the same results as the scalar kernels.
+ * Usage: bench
+ */
+#include "kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NSAMPLES 4093 // Not a multiple of any vector width
+#define NREPEATS 2000
+
+enum
+{
+    BENCH_GAIN,
+    BENCH_ENVELOPE,
+    BENCH_PEAK,
+    BENCH_CONVERT,
+    BENCH_SINE,
+    BENCH_NKERNELS
+};
+
+static const char *names[BENCH_NKERNELS] = {"gain", "envelope", "peak",
+                                            "convert", "sine"};
+
+static float input[NSAMPLES], out[NSAMPLES], reference[NSAMPLES];
+static double env[NSAMPLES], phases[NSAMPLES];
+
+// Run kernel of set once, writing its result to out
+static void run(const KERNELS *set, int kernel)
+{
+    switch (kernel)
+    {
+    case BENCH_GAIN:
+        memcpy(out, input, sizeof(out));
+        set->gain(out, 0.7f, NSAMPLES);
+        break;
+    case BENCH_ENVELOPE:
+        memcpy(out, input, sizeof(out));
+        set->envelope(out, env, NSAMPLES);
+        break;
+    case BENCH_PEAK:
+        out[0] = set->peak(input, NSAMPLES);
+        break;
+    case BENCH_CONVERT:
+        set->convert(out, env, 0.7, NSAMPLES);
+        break;
+    case BENCH_SINE:
+        set->sine(out, phases, NSAMPLES);
+        break;
+    }
+}
+
+int main(void)
+{
+    srand(1);
+    for (size_t i = 0; i < NSAMPLES; ++i)
+    {
+        input[i] = 2.f * rand() / RAND_MAX - 1.f;
+        env[i] = (double)rand() / RAND_MAX;
+        phases[i] = 2.0 * 3.14159265358979323846 * i / NSAMPLES;
+    }
+
+    int mismatches = 0;
+    printf("%-9s %-7s %12s\n", "kernel", "level", "time/sample");
+    for (int kernel = 0; kernel < BENCH_NKERNELS; ++kernel)
+    {
+        run(kernels_level(KERNEL_SCALAR), kernel);
+        memcpy(reference, out, sizeof(out));
+        for (int level = 0; level < KERNEL_NLEVELS; ++level)
+        {
+            const KERNELS *set = kernels_level((KERNEL_LEVEL)level);
+            if (set == NULL)
+                continue;
+            clock_t start = clock();
+            for (int n = 0; n < NREPEATS; ++n)
+                run(set, kernel);
+            double ns = (clock() - start) * 1e9 / CLOCKS_PER_SEC / NREPEATS /
+                        NSAMPLES;
+            size_t count = kernel == BENCH_PEAK ? 1 : NSAMPLES;
+            int same = memcmp(out, reference, count * sizeof(float)) == 0;
+            mismatches += !same;
+            printf("%-9s %-7s %9.3f ns%s\n", names[kernel], set->name, ns,
+                   same ? "" : "  MISMATCH");
+        }
+    }
+    printf("Selected: %s\n", kernels()->name);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
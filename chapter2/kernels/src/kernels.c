@@ -0,0 +1,431 @@
+#include "kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+#define PI 3.14159265358979323846
+
+// Coefficients of the sine polynomial, lowest order first
+#define SINE_C0 0.999999976589883
+#define SINE_C1 -0.166666476346403
+#define SINE_C2 0.008332899823360418
+#define SINE_C3 -0.00019800897763281068
+#define SINE_C4 2.590488501433902e-06
+
+/*
+ * Scalar kernels, the reference for the others. The vector kernels do the
+ * same operations in the same order lane by lane, and hand the last samples
+ * that do not fill a vector to the next narrower level.
+ */
+
+static void gain_scalar(float *buf, float gain, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        buf[i] *= gain;
+}
+
+static void envelope_scalar(float *buf, const double *env, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        buf[i] = (float)(buf[i] * env[i]);
+}
+
+static float peak_scalar(const float *buf, size_t n)
+{
+    float peak = 0.f;
+    for (size_t i = 0; i < n; ++i)
+    {
+        float absval = fabsf(buf[i]);
+        peak = absval > peak ? absval : peak;
+    }
+    return peak;
+}
+
+static void convert_scalar(float *out, const double *in, double scale,
+                           size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = (float)(scale * in[i]);
+}
+
+static void sine_scalar(float *out, const double *phases, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        // Reflect the phase into [-pi/2, pi/2]
+        double x = phases[i];
+        if (x > 1.5 * PI)
+            x -= 2.0 * PI;
+        else if (x > 0.5 * PI)
+            x = PI - x;
+        double x2 = x * x;
+        out[i] = (float)(x * (SINE_C0 +
+                              x2 * (SINE_C1 +
+                                    x2 * (SINE_C2 +
+                                          x2 * (SINE_C3 + x2 * SINE_C4)))));
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("sse2"))) static void gain_sse2(float *buf, float gain,
+                                                      size_t n)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+    gain_scalar(buf + i, gain, n - i);
+}
+
+__attribute__((target("sse2"))) static void
+envelope_sse2(float *buf, const double *env, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 in = _mm_loadu_ps(buf + i);
+        const __m128d lo = _mm_mul_pd(_mm_cvtps_pd(in), _mm_loadu_pd(env + i));
+        const __m128d hi = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(in, in)),
+                                      _mm_loadu_pd(env + i + 2));
+        _mm_storeu_ps(buf + i,
+                      _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+    }
+    envelope_scalar(buf + i, env + i, n - i);
+}
+
+__attribute__((target("sse2"))) static float peak_sse2(const float *buf,
+                                                      size_t n)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    __m128 peak = _mm_setzero_ps();
+    size_t i = 0;
+    // max returns its second operand for a NaN, so NaNs are skipped as in
+    // the scalar kernel
+    for (; i + 4 <= n; i += 4)
+        peak = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(buf + i)), peak);
+    peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+    float rest = peak_scalar(buf + i, n - i);
+    float vector = _mm_cvtss_f32(peak);
+    return rest > vector ? rest : vector;
+}
+
+__attribute__((target("sse2"))) static void
+convert_sse2(float *out, const double *in, double scale, size_t n)
+{
+    const __m128d s = _mm_set1_pd(scale);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 lo = _mm_cvtpd_ps(_mm_mul_pd(s, _mm_loadu_pd(in + i)));
+        const __m128 hi =
+            _mm_cvtpd_ps(_mm_mul_pd(s, _mm_loadu_pd(in + i + 2)));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+    }
+    convert_scalar(out + i, in + i, scale, n - i);
+}
+
+// Sine polynomial of two phases
+__attribute__((target("sse2"))) static inline __m128d sine2_sse2(__m128d x)
+{
+    const __m128d wrap = _mm_cmpgt_pd(x, _mm_set1_pd(1.5 * PI));
+    const __m128d reflect =
+        _mm_andnot_pd(wrap, _mm_cmpgt_pd(x, _mm_set1_pd(0.5 * PI)));
+    x = _mm_or_pd(
+        _mm_or_pd(_mm_and_pd(wrap, _mm_sub_pd(x, _mm_set1_pd(2.0 * PI))),
+                  _mm_and_pd(reflect, _mm_sub_pd(_mm_set1_pd(PI), x))),
+        _mm_andnot_pd(_mm_or_pd(wrap, reflect), x));
+    const __m128d x2 = _mm_mul_pd(x, x);
+    __m128d p = _mm_add_pd(_mm_set1_pd(SINE_C3),
+                           _mm_mul_pd(x2, _mm_set1_pd(SINE_C4)));
+    p = _mm_add_pd(_mm_set1_pd(SINE_C2), _mm_mul_pd(x2, p));
+    p = _mm_add_pd(_mm_set1_pd(SINE_C1), _mm_mul_pd(x2, p));
+    p = _mm_add_pd(_mm_set1_pd(SINE_C0), _mm_mul_pd(x2, p));
+    return _mm_mul_pd(x, p);
+}
+
+__attribute__((target("sse2"))) static void
+sine_sse2(float *out, const double *phases, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 lo = _mm_cvtpd_ps(sine2_sse2(_mm_loadu_pd(phases + i)));
+        const __m128 hi =
+            _mm_cvtpd_ps(sine2_sse2(_mm_loadu_pd(phases + i + 2)));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+    }
+    sine_scalar(out + i, phases + i, n - i);
+}
+
+/*
+ * The AVX2 kernels clear the upper halves of the vector registers before
+ * handing the tail to SSE code. Left dirty, they make every later SSE
+ * instruction, sin() of libm included, pay for a state transition. gcc adds
+ * these vzerouppers itself only when optimizing.
+ */
+
+__attribute__((target("avx2"))) static void gain_avx2(float *buf, float gain,
+                                                      size_t n)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+    _mm256_zeroupper();
+    gain_sse2(buf + i, gain, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+envelope_avx2(float *buf, const double *env, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256d in = _mm256_cvtps_pd(_mm_loadu_ps(buf + i));
+        _mm_storeu_ps(buf + i, _mm256_cvtpd_ps(_mm256_mul_pd(
+                                   in, _mm256_loadu_pd(env + i))));
+    }
+    _mm256_zeroupper();
+    envelope_scalar(buf + i, env + i, n - i);
+}
+
+__attribute__((target("avx2"))) static float peak_avx2(const float *buf,
+                                                      size_t n)
+{
+    const __m256 sign = _mm256_set1_ps(-0.f);
+    __m256 peak = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        peak = _mm256_max_ps(_mm256_andnot_ps(sign, _mm256_loadu_ps(buf + i)),
+                             peak);
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(peak),
+                             _mm256_extractf128_ps(peak, 1));
+    half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_max_ss(half, _mm_shuffle_ps(half, half, 1));
+    float vector = _mm_cvtss_f32(half);
+    _mm256_zeroupper();
+    float rest = peak_sse2(buf + i, n - i);
+    return rest > vector ? rest : vector;
+}
+
+__attribute__((target("avx2"))) static void
+convert_avx2(float *out, const double *in, double scale, size_t n)
+{
+    const __m256d s = _mm256_set1_pd(scale);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_mul_pd(
+                                   s, _mm256_loadu_pd(in + i))));
+    _mm256_zeroupper();
+    convert_scalar(out + i, in + i, scale, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+sine_avx2(float *out, const double *phases, size_t n)
+{
+    const __m256d x2pi = _mm256_set1_pd(2.0 * PI);
+    const __m256d xpi = _mm256_set1_pd(PI);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(phases + i);
+        const __m256d reflect =
+            _mm256_cmp_pd(x, _mm256_set1_pd(0.5 * PI), _CMP_GT_OQ);
+        const __m256d wrap =
+            _mm256_cmp_pd(x, _mm256_set1_pd(1.5 * PI), _CMP_GT_OQ);
+        x = _mm256_blendv_pd(
+            _mm256_blendv_pd(x, _mm256_sub_pd(xpi, x), reflect),
+            _mm256_sub_pd(x, x2pi), wrap);
+        const __m256d x2 = _mm256_mul_pd(x, x);
+        __m256d p = _mm256_add_pd(_mm256_set1_pd(SINE_C3),
+                                  _mm256_mul_pd(x2, _mm256_set1_pd(SINE_C4)));
+        p = _mm256_add_pd(_mm256_set1_pd(SINE_C2), _mm256_mul_pd(x2, p));
+        p = _mm256_add_pd(_mm256_set1_pd(SINE_C1), _mm256_mul_pd(x2, p));
+        p = _mm256_add_pd(_mm256_set1_pd(SINE_C0), _mm256_mul_pd(x2, p));
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_mul_pd(x, p)));
+    }
+    _mm256_zeroupper();
+    sine_scalar(out + i, phases + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static void
+gain_avx512(float *buf, float gain, size_t n)
+{
+    const __m512 g = _mm512_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(buf + i, _mm512_mul_ps(_mm512_loadu_ps(buf + i), g));
+    gain_avx2(buf + i, gain, n - i);
+}
+
+__attribute__((target("avx512f"))) static void
+envelope_avx512(float *buf, const double *env, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m512d in = _mm512_cvtps_pd(_mm256_loadu_ps(buf + i));
+        _mm256_storeu_ps(buf + i, _mm512_cvtpd_ps(_mm512_mul_pd(
+                                      in, _mm512_loadu_pd(env + i))));
+    }
+    envelope_avx2(buf + i, env + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static float
+peak_avx512(const float *buf, size_t n)
+{
+    __m512 peak = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        peak = _mm512_max_ps(_mm512_abs_ps(_mm512_loadu_ps(buf + i)), peak);
+    float vector = _mm512_reduce_max_ps(peak);
+    float rest = peak_avx2(buf + i, n - i);
+    return rest > vector ? rest : vector;
+}
+
+__attribute__((target("avx512f"))) static void
+convert_avx512(float *out, const double *in, double scale, size_t n)
+{
+    const __m512d s = _mm512_set1_pd(scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, _mm512_cvtpd_ps(_mm512_mul_pd(
+                                      s, _mm512_loadu_pd(in + i))));
+    convert_avx2(out + i, in + i, scale, n - i);
+}
+
+__attribute__((target("avx512f"))) static void
+sine_avx512(float *out, const double *phases, size_t n)
+{
+    const __m512d x2pi = _mm512_set1_pd(2.0 * PI);
+    const __m512d xpi = _mm512_set1_pd(PI);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512d x = _mm512_loadu_pd(phases + i);
+        const __mmask8 reflect =
+            _mm512_cmp_pd_mask(x, _mm512_set1_pd(0.5 * PI), _CMP_GT_OQ);
+        const __mmask8 wrap =
+            _mm512_cmp_pd_mask(x, _mm512_set1_pd(1.5 * PI), _CMP_GT_OQ);
+        x = _mm512_mask_blend_pd(
+            wrap, _mm512_mask_blend_pd(reflect, x, _mm512_sub_pd(xpi, x)),
+            _mm512_sub_pd(x, x2pi));
+        const __m512d x2 = _mm512_mul_pd(x, x);
+        __m512d p = _mm512_add_pd(_mm512_set1_pd(SINE_C3),
+                                  _mm512_mul_pd(x2, _mm512_set1_pd(SINE_C4)));
+        p = _mm512_add_pd(_mm512_set1_pd(SINE_C2), _mm512_mul_pd(x2, p));
+        p = _mm512_add_pd(_mm512_set1_pd(SINE_C1), _mm512_mul_pd(x2, p));
+        p = _mm512_add_pd(_mm512_set1_pd(SINE_C0), _mm512_mul_pd(x2, p));
+        _mm256_storeu_ps(out + i, _mm512_cvtpd_ps(_mm512_mul_pd(x, p)));
+    }
+    sine_avx2(out + i, phases + i, n - i);
+}
+
+#endif // HAVE_X86_KERNELS
+
+static const KERNELS kernel_sets[KERNEL_NLEVELS] = {
+    {"scalar", gain_scalar, envelope_scalar, peak_scalar, convert_scalar,
+     sine_scalar},
+#ifdef HAVE_X86_KERNELS
+    {"sse2", gain_sse2, envelope_sse2, peak_sse2, convert_sse2, sine_sse2},
+    {"avx2", gain_avx2, envelope_avx2, peak_avx2, convert_avx2, sine_avx2},
+    {"avx512", gain_avx512, envelope_avx512, peak_avx512, convert_avx512,
+     sine_avx512},
+#endif
+};
+
+static const KERNELS *selected = NULL;
+
+// Best level the CPU supports, by cpuid
+static KERNEL_LEVEL detect_level(void)
+{
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return KERNEL_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return KERNEL_SSE2;
+#endif
+    return KERNEL_SCALAR;
+}
+
+const KERNELS *kernels(void)
+{
+    if (selected == NULL)
+        selected = &kernel_sets[detect_level()];
+    return selected;
+}
+
+const KERNELS *kernels_level(KERNEL_LEVEL level)
+{
+    if (level < KERNEL_SCALAR || level > detect_level())
+        return NULL;
+    return &kernel_sets[level];
+}
+
+int kernels_select(const char *name)
+{
+    for (int level = KERNEL_SCALAR; level < KERNEL_NLEVELS; ++level)
+    {
+        const KERNELS *set = kernels_level((KERNEL_LEVEL)level);
+        if (set && strcmp(set->name, name) == 0)
+        {
+            selected = set;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int kernels_args(int *argc, char *argv[])
+{
+    for (int i = 1; i < *argc; ++i)
+    {
+        const char *name;
+        int used; // Arguments taken by the option
+        if (strcmp(argv[i], "--kernel") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                printf("Error: --kernel needs a kernel name\n");
+                return -1;
+            }
+            name = argv[i + 1];
+            used = 2;
+        }
+        else if (strncmp(argv[i], "--kernel=", 9) == 0)
+        {
+            name = argv[i] + 9;
+            used = 1;
+        }
+        else
+            continue;
+
+        if (kernels_select(name))
+        {
+            printf("Error: kernel %s is unknown or not supported by this "
+                   "CPU\nKernels available:",
+                   name);
+            for (int level = KERNEL_SCALAR; level < KERNEL_NLEVELS; ++level)
+                if (kernels_level((KERNEL_LEVEL)level))
+                    printf(" %s", kernel_sets[level].name);
+            printf("\n");
+            return -1;
+        }
+        // Shift the rest of argv, including its terminating NULL, over it
+        for (int j = i; j + used <= *argc; ++j)
+            argv[j] = argv[j + used];
+        *argc -= used;
+        --i;
+    }
+    return 0;
+}
@@ -15,6 +15,16 @@ typedef struct oscil_t
 typedef double (*tickfunc)(OSCIL *osc, double freq);
 typedef double (*pwmtickfunc)(OSCIL *osc, double freq, double pwmod);
 
+// Sine engines of sine_block
+typedef enum sine_mode
+{
+    SINE_LIBM,       // sin(), exact
+    SINE_ROTATION,   // Recursive quadrature oscillator, max error 1e-10
+    SINE_POLYNOMIAL, // Minimax polynomial, max error 3.4e-9
+    SINE_TABLE,      // 4096 point interpolated table, max error 3.3e-7
+    SINE_NMODES
+} SINE_MODE;
+
 OSCIL *new_oscil(size_t sample_rate);
 OSCIL *new_oscilp(size_t sample_rate, double phase);
 double sinetick(OSCIL *osc, double freq);
@@ -22,4 +32,31 @@ double sqrtick(OSCIL *osc, double freq);
 double pwmtick(OSCIL *osc, double freq, double pwmod);
 double sawdtick(OSCIL *osc, double freq);
 double sawutick(OSCIL *osc, double freq);
-double tritick(OSCIL *osc, double freq);
\ No newline at end of file
+double tritick(OSCIL *osc, double freq);
+
+// Waveforms of the block generators
+typedef enum waveform
+{
+    WAVEFORM_SINE,
+    WAVEFORM_TRIANGLE,
+    WAVEFORM_SAW_UP,
+    WAVEFORM_SAW_DOWN,
+    WAVEFORM_SQUARE,
+    WAVEFORM_NFORMS
+} WAVEFORM;
+
+// Block generators, producing the samples of the ticks above in double
+void oscil_fill(OSCIL *osc, WAVEFORM waveform, double freq, double *out,
+                size_t n);
+void oscil_fill_fm(OSCIL *osc, WAVEFORM waveform, const double *freqs,
+                   double *out, size_t n);
+void pwm_fill(OSCIL *osc, const double *freqs, const double *pwmods,
+              double *out, size_t n);
+
+// Fast sine engines, see SINE_MODE. The table is built on first use.
+void sine_block(OSCIL *osc, SINE_MODE mode, double freq, double *out,
+                size_t n);
+// Names of the engines for the -e option, and the engine named name or
+// SINE_NMODES if there is none
+extern const char *const sine_mode_names[SINE_NMODES];
+SINE_MODE sine_mode_named(const char *name);
@@ -1,11 +1,19 @@
+#define _POSIX_C_SOURCE 200809L
 #include "breakpoints.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /*
- * Read breakpoint values from a file
+ * Read breakpoint values from a stream line by line
  * fp - pointer to file conatining breakpoints
  * psize [out] - size of breakpoint array
  */
-BREAKPOINT *get_breakpoints(FILE *fp, size_t *psize)
+static BREAKPOINT *read_breakpoints(FILE *fp, size_t *psize)
 {
     long npoints = 0; // Number of breakpoints
     long size = 64;   // Initial size of breakpoint array
@@ -67,6 +75,485 @@ BREAKPOINT *get_breakpoints(FILE *fp, size_t *psize)
     return points;
 }
 
+/*
+ * Breakpoint files are read through a memory mapping when possible. The
+ * lines of a mapped file are parsed in place, and large files are split at
+ * line boundaries into chunks that are parsed in parallel.
+ */
+
+#define PARSE_CHUNK_MIN (1 << 20) // Smallest chunk worth a thread, bytes
+#define PARSE_MAX_THREADS 8
+
+typedef enum parse_error
+{
+    PARSE_OK,
+    PARSE_NON_NUMERIC,
+    PARSE_INCOMPLETE,
+    PARSE_DECREASING
+} PARSE_ERROR;
+
+typedef struct parse_chunk
+{
+    const char *begin, *end; // Text of whole lines
+    BREAKPOINT *points;      // Room for a point per line
+    double last_time;        // Smallest time allowed for the first point
+    size_t npoints;
+    size_t first_line; // Line of the first point, counted from 1
+    size_t nlines;     // Lines parsed, up to the failed one
+    PARSE_ERROR error; // Error on line nlines
+} PARSE_CHUNK;
+
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Exactly representable powers of ten
+static const double powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/*
+ * strtod for the plain decimals breakpoint files are made of. A number of
+ * at most 15 significant digits is an exact integer divided by an exact
+ * power of ten, and the division rounds it correctly, so the result is the
+ * same as that of strtod. Anything else is left to strtod.
+ */
+static double parse_number(const char *p, char **end)
+{
+    const char *s = p;
+    bool negative = *s == '-';
+    if (*s == '-' || *s == '+')
+        s++;
+    uint64_t mantissa = 0;
+    int ndigits = 0, scale = 0;
+    bool fraction = false, any_digit = false;
+    for (;; ++s)
+    {
+        if (*s >= '0' && *s <= '9')
+        {
+            any_digit = true;
+            if (mantissa || *s != '0')
+                ndigits++;
+            mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+            scale += fraction;
+            if (ndigits > 15)
+                return strtod(p, end);
+        }
+        else if (*s == '.' && !fraction)
+            fraction = true;
+        else
+            break;
+    }
+    // No number here. strtod would skip whitespace, newlines included, and
+    // read on into the next line, so it only gets a chance at inf and nan.
+    if (!any_digit && !isalpha((unsigned char)*s))
+    {
+        *end = (char *)p;
+        return 0.0;
+    }
+    if (!any_digit || *s == 'e' || *s == 'E' || *s == 'x' || *s == 'X' ||
+        scale >= (int)(sizeof(powers_of_ten) / sizeof(powers_of_ten[0])))
+        return strtod(p, end);
+    *end = (char *)s;
+    double value = (double)mantissa / powers_of_ten[scale];
+    return negative ? -value : value;
+}
+
+/*
+ * Parse "time value" from the line starting at p and ending at a newline or
+ * NUL. Returns the number of values read like sscanf, or -1 if the line is
+ * empty.
+ */
+static int parse_line(const char *p, BREAKPOINT *point)
+{
+    char *end;
+    // strtod would skip a newline too, so blanks are skipped by hand
+    while (is_blank(*p))
+        p++;
+    if (*p == '\n' || *p == '\0')
+        return -1;
+    point->time = parse_number(p, &end);
+    if (end == p)
+        return 0;
+    for (p = end; is_blank(*p); p++)
+        ;
+    if (*p == '\n' || *p == '\0')
+        return 1;
+    point->value = parse_number(p, &end);
+    return end == p ? 1 : 2;
+}
+
+static void *parse_chunk(void *arg)
+{
+    PARSE_CHUNK *chunk = arg;
+    const char *line = chunk->begin;
+    double last_time = chunk->last_time;
+    char *last_line = NULL; // Copy of a last line without newline
+    while (line < chunk->end && chunk->error == PARSE_OK)
+    {
+        const char *newline = memchr(line, '\n', chunk->end - line);
+        const char *text = line;
+        if (newline == NULL)
+        {
+            // strtod needs a terminator at the end of the mapping
+            size_t length = chunk->end - line;
+            last_line = malloc(length + 1);
+            if (last_line == NULL)
+                break;
+            memcpy(last_line, line, length);
+            last_line[length] = '\0';
+            text = last_line;
+            newline = chunk->end;
+        }
+        chunk->nlines++;
+        BREAKPOINT *point = &chunk->points[chunk->npoints];
+        int got = parse_line(text, point);
+        if (got == 0)
+            chunk->error = PARSE_NON_NUMERIC;
+        else if (got == 1)
+            chunk->error = PARSE_INCOMPLETE;
+        else if (got == 2 && point->time < last_time)
+            chunk->error = PARSE_DECREASING;
+        else if (got == 2)
+        {
+            if (chunk->npoints++ == 0)
+                chunk->first_line = chunk->nlines;
+            last_time = point->time;
+        }
+        line = newline + 1;
+    }
+    free(last_line);
+    return NULL;
+}
+
+static void report_error(PARSE_ERROR error, size_t line)
+{
+    switch (error)
+    {
+    case PARSE_NON_NUMERIC:
+        printf("Line %zu has non-numeric data\n", line);
+        break;
+    case PARSE_INCOMPLETE:
+        printf("Line %zu has an incomplete breakpoint\n", line);
+        break;
+    case PARSE_DECREASING:
+        printf("Breakpoint at line %zu not increasing in time\n", line);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Parse the breakpoints of text, size bytes. Stops at the first invalid
+ * line like read_breakpoints. Returns NULL if out of memory.
+ */
+static BREAKPOINT *parse_breakpoints(const char *text, size_t size,
+                                     size_t *psize)
+{
+    PARSE_CHUNK chunks[PARSE_MAX_THREADS];
+    pthread_t threads[PARSE_MAX_THREADS];
+    bool started[PARSE_MAX_THREADS] = {false};
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nchunks = size / PARSE_CHUNK_MIN + 1;
+    if (ncpus > 0 && nchunks > (size_t)ncpus)
+        nchunks = (size_t)ncpus;
+    if (nchunks > PARSE_MAX_THREADS)
+        nchunks = PARSE_MAX_THREADS;
+
+    // Split at line boundaries, and give each chunk room for its lines
+    size_t first_point[PARSE_MAX_THREADS], maxpoints = 0;
+    const char *begin = text, *end = text + size;
+    for (size_t i = 0; i < nchunks; ++i)
+    {
+        const char *chunk_end = end;
+        if (i + 1 < nchunks)
+        {
+            const char *split = text + size / nchunks * (i + 1);
+            if (split < begin)
+                split = begin;
+            const char *newline = memchr(split, '\n', end - split);
+            chunk_end = newline ? newline + 1 : end;
+        }
+        size_t nlines = 1;
+        for (const char *p = begin;
+             (p = memchr(p, '\n', chunk_end - p)) != NULL; ++p)
+            nlines++;
+        chunks[i] = (PARSE_CHUNK){begin, chunk_end, NULL, -INFINITY, 0, 0, 0,
+                                  PARSE_OK};
+        first_point[i] = maxpoints;
+        maxpoints += nlines;
+        begin = chunk_end;
+    }
+    chunks[0].last_time = 0.0;
+
+    BREAKPOINT *points = malloc(maxpoints * sizeof(BREAKPOINT));
+    if (points == NULL)
+        return NULL;
+    for (size_t i = 0; i < nchunks; ++i)
+        chunks[i].points = points + first_point[i];
+
+    // A chunk whose thread does not start is parsed here
+    for (size_t i = 1; i < nchunks; ++i)
+        started[i] =
+            pthread_create(&threads[i], NULL, parse_chunk, &chunks[i]) == 0;
+    parse_chunk(&chunks[0]);
+    for (size_t i = 1; i < nchunks; ++i)
+    {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            parse_chunk(&chunks[i]);
+    }
+
+    // Join the points of the chunks up to the first error
+    size_t npoints = 0, line_base = 0;
+    double last_time = 0.0;
+    for (size_t i = 0; i < nchunks; ++i)
+    {
+        const PARSE_CHUNK *chunk = &chunks[i];
+        if (chunk->npoints && chunk->points[0].time < last_time)
+        {
+            report_error(PARSE_DECREASING, line_base + chunk->first_line);
+            break;
+        }
+        memmove(points + npoints, chunk->points,
+                chunk->npoints * sizeof(BREAKPOINT));
+        npoints += chunk->npoints;
+        if (chunk->npoints)
+            last_time = chunk->points[chunk->npoints - 1].time;
+        if (chunk->error != PARSE_OK)
+        {
+            report_error(chunk->error, line_base + chunk->nlines);
+            break;
+        }
+        line_base += chunk->nlines;
+    }
+
+    if (npoints)
+    {
+        BREAKPOINT *tmp = realloc(points, npoints * sizeof(BREAKPOINT));
+        points = tmp ? tmp : points;
+        *psize = npoints;
+    }
+    return points;
+}
+
+/*
+ * Binary breakpoint files, see breakpoints.h
+ */
+
+typedef struct brkbin_header
+{
+    char magic[4];
+    uint32_t version, flags, reserved;
+    uint64_t npoints;
+} BRKBIN_HEADER; // 24 bytes, no padding
+
+static const char brkbin_magic[4] = {'B', 'R', 'K', 'B'};
+
+static size_t brkbin_pair_size(uint32_t flags)
+{
+    return flags & BRKBIN_FLOAT32 ? 2 * sizeof(float) : 2 * sizeof(double);
+}
+
+static bool is_binary(const char *data, size_t size)
+{
+    return size >= sizeof(brkbin_magic) &&
+           memcmp(data, brkbin_magic, sizeof(brkbin_magic)) == 0;
+}
+
+/*
+ * Read the header of the binary breakpoints data, size bytes, to header.
+ * Prints an error and returns false if the header is not valid.
+ */
+static bool read_brkbin_header(const char *data, size_t size,
+                               BRKBIN_HEADER *header)
+{
+    if (size < sizeof(*header))
+    {
+        printf("Error: binary breakpoint file is truncated\n");
+        return false;
+    }
+    memcpy(header, data, sizeof(*header));
+    if (header->version != BRKBIN_VERSION ||
+        (header->flags & ~(uint32_t)(BRKBIN_FLOAT32 | BRKBIN_DELTA)))
+    {
+        printf("Error: unsupported binary breakpoint file (version %u, "
+               "flags %u)\n",
+               (unsigned)header->version, (unsigned)header->flags);
+        return false;
+    }
+    if ((size - sizeof(*header)) / brkbin_pair_size(header->flags) <
+        header->npoints)
+    {
+        printf("Error: binary breakpoint file is truncated\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Number of points from the start that increase in time, as in a text
+ * file. Reports the first point out of order.
+ */
+static size_t increasing_points(const BREAKPOINT *points, size_t npoints)
+{
+    double last_time = 0.0;
+    for (size_t i = 0; i < npoints; ++i)
+    {
+        if (points[i].time < last_time)
+        {
+            printf("Breakpoint %zu not increasing in time\n", i + 1);
+            return i;
+        }
+        last_time = points[i].time;
+    }
+    return npoints;
+}
+
+// Decode npoints pairs stored with flags to points
+static void decode_pairs(const char *pairs, uint32_t flags,
+                         BREAKPOINT *points, size_t npoints)
+{
+    if (flags == 0) // Stored as they are in memory
+    {
+        memcpy(points, pairs, npoints * sizeof(BREAKPOINT));
+        return;
+    }
+    double time = 0.0;
+    for (size_t i = 0; i < npoints; ++i)
+    {
+        double pair[2];
+        if (flags & BRKBIN_FLOAT32)
+        {
+            float stored[2];
+            memcpy(stored, pairs + i * sizeof(stored), sizeof(stored));
+            pair[0] = stored[0];
+            pair[1] = stored[1];
+        }
+        else
+            memcpy(pair, pairs + i * sizeof(pair), sizeof(pair));
+        time = flags & BRKBIN_DELTA ? time + pair[0] : pair[0];
+        points[i].time = time;
+        points[i].value = pair[1];
+    }
+}
+
+// Breakpoints of the binary breakpoints data, size bytes, in a new array
+static BREAKPOINT *load_binary(const char *data, size_t size, size_t *psize)
+{
+    BRKBIN_HEADER header;
+    if (!read_brkbin_header(data, size, &header))
+        return NULL;
+    size_t npoints = (size_t)header.npoints;
+    BREAKPOINT *points = malloc((npoints ? npoints : 1) * sizeof(BREAKPOINT));
+    if (points == NULL)
+        return NULL;
+    decode_pairs(data + sizeof(header), header.flags, points, npoints);
+    npoints = increasing_points(points, npoints);
+    if (npoints)
+        *psize = npoints;
+    return points;
+}
+
+/*
+ * Map the whole of the regular file fp. Sets *offset to its current
+ * position. Returns NULL if fp cannot be mapped or has nothing left.
+ */
+static char *map_file(FILE *fp, int prot, size_t *mapped_size, size_t *offset)
+{
+    struct stat st;
+    long position = ftell(fp);
+    int fd = fileno(fp);
+    if (position < 0 || fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+        st.st_size <= position)
+        return NULL;
+    void *mapping = mmap(NULL, st.st_size, prot, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+        return NULL;
+    *mapped_size = st.st_size;
+    *offset = position;
+    return mapping;
+}
+
+/*
+ * Read breakpoint values from a file
+ * fp - pointer to file conatining breakpoints
+ * psize [out] - size of breakpoint array
+ * A regular file is mapped, and parsed from its current position or copied
+ * if it is in the binary format. Anything else is read line by line as
+ * text.
+ */
+BREAKPOINT *get_breakpoints(FILE *fp, size_t *psize)
+{
+    if (fp == NULL)
+        return NULL;
+
+    size_t mapped_size, offset;
+    char *mapping = map_file(fp, PROT_READ, &mapped_size, &offset);
+    if (mapping == NULL)
+        return read_breakpoints(fp, psize);
+
+    const char *data = mapping + offset;
+    size_t size = mapped_size - offset;
+    BREAKPOINT *points = is_binary(data, size)
+                             ? load_binary(data, size, psize)
+                             : parse_breakpoints(data, size, psize);
+    munmap(mapping, mapped_size);
+    fseek(fp, 0, SEEK_END); // The file has been read
+    return points;
+}
+
+/*
+ * Write npoints breakpoints to fp as text, with enough digits to be read
+ * back exactly. Returns 0 on success.
+ */
+int write_breakpoints_text(FILE *fp, const BREAKPOINT *points, size_t npoints)
+{
+    for (size_t i = 0; i < npoints; ++i)
+        if (fprintf(fp, "%.17g\t%.17g\n", points[i].time, points[i].value) < 0)
+            return -1;
+    return 0;
+}
+
+/*
+ * Write npoints breakpoints to fp in the binary format with flags, see
+ * BRKBIN_FLAGS. Returns 0 on success.
+ */
+int write_breakpoints_binary(FILE *fp, const BREAKPOINT *points,
+                             size_t npoints, unsigned flags)
+{
+    BRKBIN_HEADER header = {{'B', 'R', 'K', 'B'},
+                            BRKBIN_VERSION,
+                            (uint32_t)flags,
+                            0,
+                            (uint64_t)npoints};
+    if (fwrite(&header, sizeof(header), 1, fp) != 1)
+        return -1;
+    // Deltas are taken from the time the reader will have summed, so that
+    // their rounding errors do not accumulate
+    double time = 0.0;
+    for (size_t i = 0; i < npoints; ++i)
+    {
+        double pair[2] = {points[i].time, points[i].value};
+        if (flags & BRKBIN_DELTA)
+            pair[0] -= time;
+        if (flags & BRKBIN_FLOAT32)
+        {
+            float stored[2] = {(float)pair[0], (float)pair[1]};
+            pair[0] = stored[0];
+            if (fwrite(stored, sizeof(stored), 1, fp) != 1)
+                return -1;
+        }
+        else if (fwrite(pair, sizeof(pair), 1, fp) != 1)
+            return -1;
+        time = flags & BRKBIN_DELTA ? time + pair[0] : pair[0];
+    }
+    return 0;
+}
+
 /*
  * Checks that all breakpoints values are between min_val and max_val.
  * Returns true, if every point is in range, false otherwise.
@@ -88,26 +575,16 @@ bool in_range(const BREAKPOINT *points, double min_val, double max_val,
 }
 
 /*
- * Calculate value at specified time (between or at breakpoints).
- * Returns value at specified time
+ * Value of the span ending at points[index] at time, or the last value if
+ * index is past the last point
  */
-double val_at_brktime(const BREAKPOINT *points, size_t npoints, double time)
+static double span_value(const BREAKPOINT *points, size_t npoints,
+                         size_t index, double time)
 {
-    BREAKPOINT left, right;
-    static size_t i = 1;
-    for (; i < npoints; i++) // Find breakpoints that surround time
-    {
-        if (time <= points[i].time)
-            break;
-    }
+    if (index == npoints) // Retain value if after last breakpoint
+        return points[npoints - 1].value;
 
-    if (i == npoints) // Retain value if after last breakpoint
-    {
-        return points[i - 1].value;
-    }
-
-    left = points[i - 1];
-    right = points[i];
+    const BREAKPOINT left = points[index - 1], right = points[index];
     const double width = right.time - left.time;
     if (width == 0.0) // if breakpoints at same time
         return right.value;
@@ -117,6 +594,66 @@ double val_at_brktime(const BREAKPOINT *points, size_t npoints, double time)
     return left.value + ((right.value - left.value) * fraction);
 }
 
+/*
+ * Calculate value at specified time (between or at breakpoints).
+ * Returns value at specified time
+ */
+double val_at_brktime(const BREAKPOINT *points, size_t npoints, double time)
+{
+    BRKCURSOR cursor;
+    brkcursor_init(&cursor, points, npoints);
+    return brkcursor_seek(&cursor, time);
+}
+
+/*
+ * Start a cursor over npoints (at least one) breakpoints. The cursor only
+ * refers to points, which must outlive it.
+ */
+void brkcursor_init(BRKCURSOR *cursor, const BREAKPOINT *points,
+                    size_t npoints)
+{
+    cursor->points = points;
+    cursor->npoints = npoints;
+    cursor->index = 1;
+}
+
+/*
+ * Value at time, searching forward from the previous lookup. Amortized O(1)
+ * for times that do not decrease. An earlier time is looked up with
+ * brkcursor_seek.
+ */
+double brkcursor_step(BRKCURSOR *cursor, double time)
+{
+    const BREAKPOINT *points = cursor->points;
+    size_t i = cursor->index;
+    if (i > 1 && time <= points[i - 1].time)
+        return brkcursor_seek(cursor, time);
+    while (i < cursor->npoints && time > points[i].time)
+        i++;
+    cursor->index = i;
+    return span_value(points, cursor->npoints, i, time);
+}
+
+/*
+ * Value at any time by binary search, O(log n). Later steps continue from
+ * there.
+ */
+double brkcursor_seek(BRKCURSOR *cursor, double time)
+{
+    // First point from 1 on at or after time
+    size_t low = 1, high = cursor->npoints;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (time <= cursor->points[mid].time)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    cursor->index = low;
+    return span_value(cursor->points, cursor->npoints, low, time);
+}
+
 /*
  * Get minimum and maximum value of breakpoints
  */
@@ -135,6 +672,39 @@ MINMAX_PAIR get_minmax(const BREAKPOINT *points, size_t size)
     return (MINMAX_PAIR){min, max};
 }
 
+/*
+ * Use the points of the binary breakpoint file fp in place, if they are
+ * stored as doubles without deltas. Returns them and sets *mapping and
+ * *mapped_size for munmap, or leaves *mapping NULL if the file has to be
+ * loaded with get_breakpoints.
+ */
+static BREAKPOINT *map_binary(FILE *fp, size_t *npoints, void **mapping,
+                              size_t *mapped_size)
+{
+    size_t offset;
+    char *data = map_file(fp, PROT_READ | PROT_WRITE, mapped_size, &offset);
+    if (data == NULL)
+        return NULL;
+    // Anything else, including invalid files, is left to get_breakpoints
+    BRKBIN_HEADER header;
+    size_t size = *mapped_size - offset;
+    if (size >= sizeof(header))
+        memcpy(&header, data + offset, sizeof(header));
+    if (size < sizeof(header) || !is_binary(data + offset, size) ||
+        header.version != BRKBIN_VERSION || header.flags != 0 ||
+        (size - sizeof(header)) / sizeof(BREAKPOINT) < header.npoints ||
+        (offset + sizeof(header)) % sizeof(double) != 0)
+    {
+        munmap(data, *mapped_size);
+        return NULL;
+    }
+    *mapping = data;
+    BREAKPOINT *points = (BREAKPOINT *)(data + offset + sizeof(header));
+    *npoints = increasing_points(points, (size_t)header.npoints);
+    fseek(fp, 0, SEEK_END); // The file has been read
+    return points;
+}
+
 /**
  * Creates a new breakpoint stream. Remember to call bps_freepoints() after use.
  */
@@ -151,8 +721,12 @@ BRKSTREAM *bps_newstream(FILE *file, size_t srate, size_t *size)
 
     // Load breakpoint file and setup stream info
     size_t npoints = 0;
-    BREAKPOINT *points = get_breakpoints(file, &npoints);
-    if (points == NULL)
+    stream->mapping = NULL;
+    stream->points = map_binary(file, &npoints, &stream->mapping,
+                                &stream->mapped_size);
+    if (stream->mapping == NULL)
+        stream->points = get_breakpoints(file, &npoints);
+    if (stream->points == NULL)
     {
         free(stream);
         return NULL;
@@ -162,13 +736,33 @@ BRKSTREAM *bps_newstream(FILE *file, size_t srate, size_t *size)
     {
         printf("Error: too few breakpoints in breakpoint file. Minimum 2 "
                "required.\n");
+        bps_freepoints(stream);
         free(stream);
         return NULL;
     }
 
-    // Init the stream object
+    // Init the stream object, keeping the mapping of the points
+    void *mapping = stream->mapping;
+    size_t mapped_size = stream->mapped_size;
+    bps_init(stream, stream->points, npoints, srate);
+    stream->mapping = mapping;
+    stream->mapped_size = mapped_size;
+    if (size)
+        *size = stream->npoints;
+    return stream;
+}
+
+/**
+ * Initialize stream over npoints (at least 2) points owned by the caller,
+ * at time 0. Such a stream is not passed to bps_freepoints.
+ */
+void bps_init(BRKSTREAM *stream, BREAKPOINT *points, size_t npoints,
+              size_t srate)
+{
     stream->points = points;
     stream->npoints = npoints;
+    stream->mapping = NULL;
+    stream->mapped_size = 0;
     // Counters
     stream->curpos = 0.0;
     stream->ileft = 0;
@@ -181,9 +775,6 @@ BRKSTREAM *bps_newstream(FILE *file, size_t srate, size_t *size)
     stream->width = stream->rightpoint.time - stream->leftpoint.time;
     stream->height = stream->rightpoint.value - stream->leftpoint.value;
     stream->more_points = 1;
-    if (size)
-        *size = stream->npoints;
-    return stream;
 }
 
 /**
@@ -191,13 +782,41 @@ BRKSTREAM *bps_newstream(FILE *file, size_t srate, size_t *size)
  */
 void bps_freepoints(BRKSTREAM *stream)
 {
-    if (stream && stream->points)
+    if (stream && stream->mapping)
+    {
+        munmap(stream->mapping, stream->mapped_size);
+        stream->mapping = NULL;
+        stream->points = NULL;
+    }
+    else if (stream && stream->points)
     {
         free(stream->points);
         stream->points = NULL;
     }
 }
 
+/*
+ * Step stream to the span containing curpos, past any spans ending before
+ * it, or to the end of the breakpoints
+ */
+static void bps_cross_spans(BRKSTREAM *stream)
+{
+    while (stream->curpos > stream->rightpoint.time)
+    {
+        stream->ileft++;
+        stream->iright++;
+        if (stream->iright >= stream->npoints) // end of stream
+        {
+            stream->more_points = 0;
+            return;
+        }
+        stream->leftpoint = stream->points[stream->ileft];
+        stream->rightpoint = stream->points[stream->iright];
+        stream->width = stream->rightpoint.time - stream->leftpoint.time;
+        stream->height = stream->rightpoint.value - stream->leftpoint.value;
+    }
+}
+
 /**
  * Tick function for getting values from breakpoint stream
  */
@@ -208,7 +827,7 @@ double bps_tick(BRKSTREAM *stream)
     if (stream->more_points == 0)
         return stream->rightpoint.value;
     if (stream->width == 0.0)
-        return stream->rightpoint.value;
+        thisval = stream->rightpoint.value;
     else
     {
         // Get value from this span using linear interpolation
@@ -218,19 +837,86 @@ double bps_tick(BRKSTREAM *stream)
     // Move up ready for next sample
     stream->curpos += stream->incr;
     if (stream->curpos > stream->rightpoint.time)
+        bps_cross_spans(stream);
+    return thisval;
+}
+
+/**
+ * Fill out with the next n values of stream, the same as n calls to
+ * bps_tick. Works a whole span at a time, without the per sample checks.
+ */
+void bps_fill(BRKSTREAM *stream, double *out, size_t n)
+{
+    size_t i = 0;
+    while (i < n && stream->more_points)
     {
-        // Need to go to next span?
-        stream->ileft++;
-        stream->iright++;
-        if (stream->iright < stream->npoints)
-        {
-            stream->leftpoint = stream->points[stream->ileft];
-            stream->rightpoint = stream->points[stream->iright];
-            stream->width = stream->rightpoint.time - stream->leftpoint.time;
-            stream->height = stream->rightpoint.value - stream->leftpoint.value;
-        }
-        else // end of stream
-            stream->more_points = 0;
+        // Walk the current span, summing the position as bps_tick does so
+        // that spans end on the same samples
+        const double right_time = stream->rightpoint.time;
+        const double incr = stream->incr;
+        const double left_time = stream->leftpoint.time;
+        const double left_value = stream->leftpoint.value;
+        const double width = stream->width, height = stream->height;
+        double curpos = stream->curpos;
+        if (width == 0.0)
+            do
+            {
+                out[i++] = stream->rightpoint.value;
+                curpos += incr;
+            } while (i < n && !(curpos > right_time));
+        else
+            do
+            {
+                out[i++] = left_value + height * ((curpos - left_time) / width);
+                curpos += incr;
+            } while (i < n && !(curpos > right_time));
+        stream->curpos = curpos;
+        if (curpos > right_time)
+            bps_cross_spans(stream);
     }
-    return thisval;
+    for (; i < n; ++i) // Beyond end of brkdata
+        out[i] = stream->rightpoint.value;
+}
+
+/**
+ * Move stream to time seconds, in O(log n). The stream continues as if
+ * bps_tick had reached time; negative times seek to the start.
+ */
+void bps_seek(BRKSTREAM *stream, double time)
+{
+    if (time < 0.0)
+        time = 0.0;
+    // The span of time ends at the first point not before it
+    size_t low = 1, high = stream->npoints;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (stream->points[mid].time < time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    stream->curpos = time;
+    stream->more_points = low < stream->npoints;
+    stream->ileft = low - 1;
+    stream->iright = low;
+    if (!stream->more_points) // Past the end, stay on the last span
+        low = stream->npoints - 1;
+    stream->leftpoint = stream->points[low - 1];
+    stream->rightpoint = stream->points[low];
+    stream->width = stream->rightpoint.time - stream->leftpoint.time;
+    stream->height = stream->rightpoint.value - stream->leftpoint.value;
+}
+
+/**
+ * Initialize clone as an independent copy of stream, over the same points.
+ * The clone does not own the points, so it is not passed to bps_freepoints
+ * and must not outlive stream. Streams sharing points may be used from
+ * different threads.
+ */
+void bps_clone(BRKSTREAM *clone, const BRKSTREAM *stream)
+{
+    *clone = *stream;
+    clone->mapping = NULL;
+    clone->mapped_size = 0;
 }
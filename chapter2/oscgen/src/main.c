@@ -1,6 +1,8 @@
 #include "breakpoints.h"
+#include "kernels.h"
 #include "macros.h"
 #include "wave.h"
+#include <string.h>
 #include <time.h>
 
 #define NFRAMES 1024
@@ -28,20 +30,38 @@ enum
     WAVE_NWAVEFORMS
 };
 
-int main(int argc, char const *argv[])
+int main(int argc, char *argv[])
 {
     int error = 0;
     PSF_PROPS outprops;
+    double *partial = NULL; // One buffer of one oscillator
+    double *sum = NULL;     // Sum of the oscillators
 
     printf("oscgen - generate tones with additive synthesis\n");
 
     // Handle commandline arguments
+    if (kernels_args(&argc, argv))
+        return EXIT_FAILURE;
+    SINE_MODE sine_mode = SINE_LIBM; // Engine of the partials
+    if (argc > 2 && strcmp(argv[1], "-e") == 0)
+    {
+        sine_mode = sine_mode_named(argv[2]);
+        if (sine_mode == SINE_NMODES)
+        {
+            printf("Error: unknown sine engine %s\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        argc -= 2;
+        argv += 2;
+    }
     if (argc < ARG_NARGS)
     {
         printf("Error: insufficient number of arguments\n");
-        printf("Usage: oscgen outfile duration srate nchannels amplitude freq "
-               "waveform noscs\nwaveform:\t0 - square\n\t\t1 - "
-               "triangle\n\t\t2 - saw (down)\n\t\t3 - saw (up)\n");
+        printf("Usage: oscgen [--kernel name] [-e engine] outfile duration "
+               "srate nchannels amplitude freq waveform noscs\nwaveform:\t0 "
+               "- square\n\t\t1 - triangle\n\t\t2 - saw (down)\n\t\t3 - "
+               "saw (up)\n-e:\t\tsine engine, one of libm (default), "
+               "rotation, polynomial and table\n");
         return EXIT_FAILURE;
     }
 
@@ -181,36 +201,38 @@ int main(int argc, char const *argv[])
     ON_MALLOC_ERROR(outframe);
 
     size_t outframes =
-        (size_t)(duration * outprops.srate + 0.5);  // Number of output frames
-    size_t nbufs = outframes / (NFRAMES);           // Number of buffers to fill
-    size_t remainder = outframes - nbufs * NFRAMES; // Count of remaining frames
-    if (remainder > 0)
-        ++nbufs;
-
-    // Generate sound
-    unsigned nframes =
-        (unsigned)outprops.chans * NFRAMES; // Number of frames in buffer
+        (size_t)(duration * outprops.srate + 0.5); // Number of output frames
+
+    partial = malloc(NFRAMES * sizeof(double));
+    ON_MALLOC_ERROR(partial);
+    sum = malloc(NFRAMES * sizeof(double));
+    ON_MALLOC_ERROR(sum);
+
+    // Generate sound, summing one buffer of every oscillator at a time
     time_t starttime = clock();
-    for (size_t i = 0; i < nbufs; i++)
+    for (size_t done = 0; done < outframes; done += NFRAMES)
     {
-        if (i == nbufs - 1) // Make only remainder amount of samples on last run
-            nframes = remainder;
-
-        for (unsigned k = 0; k < nframes; k += (unsigned)outprops.chans)
+        unsigned nframes =
+            outframes - done < NFRAMES ? (unsigned)(outframes - done) : NFRAMES;
+        for (unsigned k = 0; k < nframes; k++)
+            sum[k] = 0.0;
+        for (size_t j = 0; j < oscillator_count; j++)
         {
-            double val = 0.0; // Sample value
-            for (size_t j = 0; j < oscillator_count; j++)
-                val += osc_amps[j] *
-                       sinetick(oscillators[j], frequency * osc_freqs[j]);
-            for (unsigned chan = 0; chan < (unsigned)outprops.chans; chan++)
-            {
-                outframe[k + chan] = (float)(amplitude * val);
-            }
+            sine_block(oscillators[j], sine_mode, frequency * osc_freqs[j],
+                       partial, nframes);
+            for (unsigned k = 0; k < nframes; k++)
+                sum[k] += osc_amps[j] * partial[k];
         }
+        // Only the scaled sum is rounded to float. It is converted to the
+        // start of outframe and spread to the channels from the end, so
+        // that no frame is overwritten before it has been copied.
+        kernels()->convert(outframe, sum, amplitude, nframes);
+        for (unsigned k = nframes; k-- > 0;)
+            for (unsigned chan = outprops.chans; chan-- > 0;)
+                outframe[k * outprops.chans + chan] = outframe[k];
 
-        int written_frames = psf_sndWriteFloatFrames(
-            ofd, outframe, nframes / (unsigned)outprops.chans);
-        if (written_frames != (int)nframes / outprops.chans)
+        int written_frames = psf_sndWriteFloatFrames(ofd, outframe, nframes);
+        if (written_frames != (int)nframes)
         {
             printf("Error writing to outfile\n");
             error++;
@@ -237,6 +259,8 @@ cleanup:
     }
     if (outframe)
         free(outframe);
+    free(partial);
+    free(sum);
     psf_finish();
     return error;
 }
@@ -1,5 +1,6 @@
 #include "wave.h"
 #include <stdio.h>
+#include <string.h>
 
 /*
  * Initialize an oscillator object
@@ -167,3 +168,291 @@ double tritick(OSCIL *osc, double freq)
         osc->current_phase += TWOPI;
     return val;
 }
+
+// Update the phase increment of osc for frequency freq
+static void set_frequency(OSCIL *osc, double freq)
+{
+    if (osc->current_freq != freq)
+    {
+        osc->current_freq = freq;
+        osc->phase_increment = osc->two_pi_over_srate * freq;
+    }
+}
+
+/*
+ * Fast sine engines. All of them follow the phase of sinetick exactly and
+ * differ only in how the sine of the phase is evaluated.
+ */
+
+#define SINE_TABLE_SIZE 4096
+#define RENORMALIZE_INTERVAL 256 // Samples between rotation renormalizations
+
+static float sine_table[SINE_TABLE_SIZE + 1]; // With guard point
+static int sine_table_ready = 0;
+
+const char *const sine_mode_names[SINE_NMODES] = {"libm", "rotation",
+                                                  "polynomial", "table"};
+
+SINE_MODE sine_mode_named(const char *name)
+{
+    int mode = 0;
+    while (mode < SINE_NMODES && strcmp(sine_mode_names[mode], name) != 0)
+        mode++;
+    return (SINE_MODE)mode;
+}
+
+static void sine_table_init(void)
+{
+    if (sine_table_ready)
+        return;
+    for (size_t i = 0; i <= SINE_TABLE_SIZE; ++i)
+        sine_table[i] = (float)sin(TWOPI * i / SINE_TABLE_SIZE);
+    sine_table_ready = 1;
+}
+
+/*
+ * Odd minimax polynomial of degree 9 for sin on [-pi/2, pi/2], max error
+ * 3.4e-9. The phase in [0, 2pi) is first reflected into that range.
+ */
+static inline double sine_poly(double phase)
+{
+    double x = phase;
+    if (x > 1.5 * M_PI)
+        x -= TWOPI;
+    else if (x > 0.5 * M_PI)
+        x = M_PI - x;
+    double x2 = x * x;
+    return x * (0.999999976589883 +
+                x2 * (-0.166666476346403 +
+                      x2 * (0.008332899823360418 +
+                            x2 * (-0.00019800897763281068 +
+                                  x2 * 2.590488501433902e-06))));
+}
+
+// Linearly interpolated lookup of a phase in [0, 2pi)
+static inline double sine_lookup(double phase)
+{
+    double position = phase * (SINE_TABLE_SIZE / TWOPI);
+    int index = (int)position;
+    if (index > SINE_TABLE_SIZE - 1) // A phase just below 2pi may round up
+        index = SINE_TABLE_SIZE - 1;
+    double fraction = position - index;
+    return sine_table[index] +
+           fraction * (sine_table[index + 1] - sine_table[index]);
+}
+
+/*
+ * Fill out with n samples of a sine at frequency freq. SINE_ROTATION turns
+ * a unit vector by the phase increment every sample, two multiply-adds per
+ * sample. Its rounding errors accumulate, so the vector is renormalized
+ * every RENORMALIZE_INTERVAL samples and taken again from the phase at the
+ * start of every block.
+ */
+void sine_block(OSCIL *osc, SINE_MODE mode, double freq, double *out,
+                size_t n)
+{
+    set_frequency(osc, freq);
+    double phase = osc->current_phase, increment = osc->phase_increment;
+    switch (mode)
+    {
+    case SINE_ROTATION:
+    {
+        double re = cos(phase), im = sin(phase);
+        double step_re = cos(increment), step_im = sin(increment);
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = im;
+            double next_re = re * step_re - im * step_im;
+            im = re * step_im + im * step_re;
+            re = next_re;
+            if (i % RENORMALIZE_INTERVAL == RENORMALIZE_INTERVAL - 1)
+            {
+                // First order correction of the magnitude towards 1
+                double scale = 1.5 - 0.5 * (re * re + im * im);
+                re *= scale;
+                im *= scale;
+            }
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        break;
+    }
+    case SINE_POLYNOMIAL:
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = sine_poly(phase);
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        break;
+    case SINE_TABLE:
+        sine_table_init();
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = sine_lookup(phase);
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = sin(phase);
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        break;
+    }
+    osc->current_phase = phase;
+}
+
+/*
+ * Block generators. The phases of a chunk are computed first, exactly as
+ * the ticks advance them, and the waveform is then evaluated in a loop of
+ * its own, so there is no call per sample.
+ */
+
+#define FILL_CHUNK 256 // Samples per phase buffer
+
+/*
+ * Write the phases of the next n (at most FILL_CHUNK) samples to phases and
+ * advance osc past them, at frequency freqs[i] for sample i or at constant
+ * frequency freq if freqs is NULL
+ */
+static void fill_phases(OSCIL *osc, double freq, const double *freqs,
+                        double *phases, size_t n)
+{
+    double phase = osc->current_phase;
+    if (freqs)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            phases[i] = phase;
+            phase += osc->two_pi_over_srate * freqs[i];
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        // Later ticks continue from the last frequency
+        set_frequency(osc, freqs[n - 1]);
+    }
+    else
+    {
+        set_frequency(osc, freq);
+        double increment = osc->phase_increment;
+        for (size_t i = 0; i < n; ++i)
+        {
+            phases[i] = phase;
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+    }
+    osc->current_phase = phase;
+}
+
+// Evaluate waveform at n phases, the same way its tick does
+static void waveform_values(WAVEFORM waveform, const double *phases,
+                            double *out, size_t n)
+{
+    switch (waveform)
+    {
+    case WAVEFORM_SINE:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = sin(phases[i]);
+        break;
+    case WAVEFORM_TRIANGLE:
+        for (size_t i = 0; i < n; ++i)
+        {
+            double val = fabs((2.0 * (phases[i] * (1.0 / TWOPI))) - 1.0);
+            out[i] = 2.0 * (val - 0.5);
+        }
+        break;
+    case WAVEFORM_SAW_UP:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = (2.0 * (phases[i] * (1.0 / TWOPI))) - 1.0;
+        break;
+    case WAVEFORM_SAW_DOWN:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = 1.0 - 2.0 * (phases[i] * (1.0 / TWOPI));
+        break;
+    case WAVEFORM_SQUARE:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = phases[i] <= M_PI ? 1.0 : -1.0;
+        break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = 0.0;
+        break;
+    }
+}
+
+static void fill(OSCIL *osc, WAVEFORM waveform, double freq,
+                 const double *freqs, double *out, size_t n)
+{
+    double phases[FILL_CHUNK];
+    for (size_t done = 0; done < n; done += FILL_CHUNK)
+    {
+        size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+        fill_phases(osc, freq, freqs ? freqs + done : NULL, phases, count);
+        waveform_values(waveform, phases, out + done, count);
+    }
+}
+
+/**
+ * Fill out with the next n samples of waveform at frequency freq
+ */
+void oscil_fill(OSCIL *osc, WAVEFORM waveform, double freq, double *out,
+                size_t n)
+{
+    fill(osc, waveform, freq, NULL, out, n);
+}
+
+/**
+ * Fill out with the next n samples of waveform, at frequency freqs[i] for
+ * sample i
+ */
+void oscil_fill_fm(OSCIL *osc, WAVEFORM waveform, const double *freqs,
+                   double *out, size_t n)
+{
+    fill(osc, waveform, 0.0, freqs, out, n);
+}
+
+/**
+ * Fill out with the next n samples of pwmtick, at frequency freqs[i] and
+ * pulse width pwmods[i] for sample i
+ */
+void pwm_fill(OSCIL *osc, const double *freqs, const double *pwmods,
+              double *out, size_t n)
+{
+    double phases[FILL_CHUNK];
+    for (size_t done = 0; done < n; done += FILL_CHUNK)
+    {
+        size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+        fill_phases(osc, 0.0, freqs + done, phases, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            double pwmod = pwmods[done + i];
+            if (pwmod > 0.99)
+                pwmod = 0.99;
+            if (pwmod < 0.01)
+                pwmod = 0.01;
+            out[done + i] = phases[i] <= M_PI * pwmod * 2 ? 1.0 : -1.0;
+        }
+    }
+}
@@ -1,9 +1,10 @@
 /*
  * Apply amplitude envelope on a sound file
- * Usage: sfenv [-n] infile outfile brkfile
+ * Usage: sfenv [--kernel name] [-n] infile outfile brkfile
  * -n: normalize breakpoint values to 1.0
  */
 #include "breakpoints.h"
+#include "kernels.h"
 #include "portsf.h"
 #include <math.h>
 #include <stdio.h>
@@ -28,6 +29,7 @@ int main(int argc, char *argv[])
     int error = 0;
     psf_format outformat = PSF_FMT_UNKNOWN;
     float *inframe = NULL;
+    double *amps = NULL; // Envelope of one buffer of frames
     // Breakpoints
     FILE *fp = NULL;
     size_t points_count = 0;
@@ -36,12 +38,14 @@ int main(int argc, char *argv[])
 
     printf("sfenv: apply amplitude envelope on a soundfile\n");
 
+    if (kernels_args(&argc, argv))
+        return EXIT_FAILURE;
     if (argc < ARG_NARGS)
     {
-        printf("Insufficient arguments\nUsage: sfenv [-n] infile outfile "
-               "breakpointfile\nBreakpoint file contains time value value "
-               "pairs between 0.0 and 1.0 (inclusive)\n-n:\tnormalize "
-               "breakpoint values to 1.0\n");
+        printf("Insufficient arguments\nUsage: sfenv [--kernel name] [-n] "
+               "infile outfile breakpointfile\nBreakpoint file contains time "
+               "value value pairs between 0.0 and 1.0 (inclusive)\n-n:\t"
+               "normalize breakpoint values to 1.0\n");
         return EXIT_FAILURE;
     }
 
@@ -144,7 +148,8 @@ int main(int argc, char *argv[])
 
     // Allocate memory for reading and writing frames
     inframe = malloc(NFRAMES * inprops.chans * sizeof(float));
-    if (inframe == NULL)
+    amps = malloc(NFRAMES * sizeof(double));
+    if (inframe == NULL || amps == NULL)
     {
         printf("No memory\n");
         error++;
@@ -155,50 +160,12 @@ int main(int argc, char *argv[])
 
     total_read = 0;          // total amount of frames read from input file
     int update_interval = 0; // essentially a loop counter
-    // amount of seconds between samples
-    const double time_incr = 1.0 / inprops.srate;
-    double sample_time = 0.0; // current time on sample
-    size_t i_left = 0,
-           i_right = 1; // counter values for left and right breakpoint
-    BREAKPOINT left_point = points[i_left];
-    BREAKPOINT right_point = points[i_right];
-    double width = right_point.time - left_point.time;
-    double height = right_point.value - left_point.value;
-    bool more_points = true; // false if end of data
-    double thisamp = 0.0;
-    double fraction = 0.0;
+    BRKSTREAM envelope; // Amplitudes from the breakpoints
+    bps_init(&envelope, points, points_count, (size_t)inprops.srate);
     while ((frames_read = psf_sndReadFloatFrames(ifd, inframe, NFRAMES)) > 0)
     {
-        for (int i = 0; i < frames_read; i++)
-        {
-            if (more_points)
-            {
-                if (width == 0.0)
-                    thisamp = right_point.value;
-                else
-                {
-                    fraction = (sample_time - left_point.time) / width;
-                    thisamp = left_point.value + (height * fraction);
-                }
-                // Move to next sample
-                sample_time += time_incr;
-                // Step to next span, if available
-                if (sample_time > right_point.time)
-                {
-                    i_left++, i_right++;
-                    if (i_right < points_count) // another span available
-                    {
-                        left_point = points[i_left];
-                        right_point = points[i_right];
-                        width = right_point.time - left_point.time;
-                        height = right_point.value - left_point.value;
-                    }
-                    else // otherwise end of data
-                        more_points = false;
-                }
-            }
-            inframe[i] = (float)(inframe[i] * thisamp);
-        }
+        bps_fill(&envelope, amps, (size_t)frames_read);
+        kernels()->envelope(inframe, amps, (size_t)frames_read);
 
         if (psf_sndWriteFloatFrames(ofd, inframe, frames_read) != frames_read)
         {
@@ -229,6 +196,8 @@ cleanup:
         psf_sndClose(ofd);
     if (inframe)
         free(inframe);
+    if (amps)
+        free(amps);
     if (points)
         free(points);
     if (fp)
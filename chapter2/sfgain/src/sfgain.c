@@ -1,11 +1,14 @@
 /**
  * Modifies amplitude of a sound file. Based on sf2float.
  */
+#include "kernels.h"
 #include "portsf.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#define NFRAMES 1024
+
 enum
 {
     ARG_PROGNAME,
@@ -22,15 +25,17 @@ int main(int argc, char *argv[])
     int ifd = -1, ofd = -1; // input & output file descriptors
     int error = 0;
     psf_format outformat = PSF_FMT_UNKNOWN;
-    float *frame = NULL;
+    float *frames = NULL;
 
     printf("sfgain: modify amplitude of a soundfile\n");
 
     // Validate arguments
+    if (kernels_args(&argc, argv))
+        return EXIT_FAILURE;
     if (argc < ARG_NARGS)
     {
-        printf("Error: Insufficient arguments\nUsage: sfgain infile outfile "
-               "modifier\n");
+        printf("Error: Insufficient arguments\nUsage: sfgain [--kernel name] "
+               "infile outfile modifier\n");
         return EXIT_FAILURE;
     }
 
@@ -81,9 +86,9 @@ int main(int argc, char *argv[])
         goto cleanup;
     }
 
-    // allocate space for one frame
-    frame = malloc(props.chans * sizeof(float));
-    if (frame == NULL)
+    // allocate space for frames
+    frames = malloc(NFRAMES * props.chans * sizeof(float));
+    if (frames == NULL)
     {
         printf("Error: No memory\n");
         error++;
@@ -92,23 +97,23 @@ int main(int argc, char *argv[])
 
     printf("Processing...\n");
 
-    frames_read = psf_sndReadFloatFrames(ifd, frame, 1);
+    const KERNELS *kernel = kernels();
+    frames_read = psf_sndReadFloatFrames(ifd, frames, NFRAMES);
     total_read = 0;
     int update_interval = 0; // essentially a loop counter
-    while (frames_read == 1)
+    while (frames_read > 0)
     {
         total_read += frames_read;
-        for (int i = 0; i < props.chans; i++)
-            frame[i] *= gain_mod;
-        if (psf_sndWriteFloatFrames(ofd, frame, 1) != 1)
+        kernel->gain(frames, gain_mod, (size_t)frames_read * props.chans);
+        if (psf_sndWriteFloatFrames(ofd, frames, frames_read) != frames_read)
         {
             printf("Error writing to outfile\n");
             error++;
             goto cleanup;
         }
 
-        frames_read = psf_sndReadFloatFrames(ifd, frame, 1);
-        if (update_interval++ % 2064 == 0)
+        frames_read = psf_sndReadFloatFrames(ifd, frames, NFRAMES);
+        if (update_interval++ % 100 == 0)
             printf("%ld samples processed\r", total_read);
     }
 
@@ -126,8 +131,8 @@ cleanup:
         psf_sndClose(ifd);
     if (ofd >= 0)
         psf_sndClose(ofd);
-    if (frame)
-        free(frame);
+    if (frames)
+        free(frames);
     psf_finish();
     return error;
 }
@@ -1,7 +1,8 @@
 /**
  * Normalizes a sound file
- * Usage: sfnorm input_file output_file dBvalue
+ * Usage: sfnorm [--kernel name] input_file output_file dBvalue
  */
+#include "kernels.h"
 #include "portsf.h"
 #include <math.h>
 #include <stdio.h>
@@ -19,20 +20,6 @@ enum
     ARG_NARGS
 };
 
-/*
- * Find peak in buf. Returns value of the peak.
- */
-double sample_peak(float *buf, size_t blocksize)
-{
-    double peak = 0.0;
-    for (size_t i = 0; i < blocksize; i++)
-    {
-        double absval = fabs(buf[i]);
-        peak = MAX(peak, absval);
-    }
-    return peak;
-}
-
 /* Converts floating point value to decibels */
 double float_to_db(float f) { return 20.0 * log10(f); }
 
@@ -55,9 +42,12 @@ int main(int argc, char *argv[])
     printf("sfnorm: Normalize a sound file\n");
 
     // Validate arguments
+    if (kernels_args(&argc, argv))
+        return EXIT_FAILURE;
     if (argc < ARG_NARGS)
     {
-        printf("Insufficient arguments\nUsage: sfnorm infile outfile dB\n");
+        printf("Insufficient arguments\nUsage: sfnorm [--kernel name] infile "
+               "outfile dB\n");
         return EXIT_FAILURE;
     }
 
@@ -115,6 +105,7 @@ int main(int argc, char *argv[])
 
     printf("Processing...\n");
 
+    const KERNELS *kernel = kernels();
     frames_read = psf_sndReadFloatFrames(ifd, frames, NFRAMES);
     total_read = 0;
     int update_interval = 0; // essentially a loop counter
@@ -129,7 +120,8 @@ int main(int argc, char *argv[])
     {
         while (frames_read > 0)
         {
-            double thispeak = sample_peak(frames, props.chans * NFRAMES);
+            double thispeak =
+                kernel->peak(frames, (size_t)frames_read * props.chans);
             inpeak = MAX(inpeak, thispeak);
             frames_read = psf_sndReadFloatFrames(ifd, frames, NFRAMES);
         }
@@ -168,9 +160,8 @@ int main(int argc, char *argv[])
     while (frames_read > 0)
     {
         total_read += frames_read;
-        for (int i = 0; i < NFRAMES * props.chans; i++)
-            frames[i] *= scalefac;
-        if (psf_sndWriteFloatFrames(ofd, frames, NFRAMES) != NFRAMES)
+        kernel->gain(frames, scalefac, (size_t)frames_read * props.chans);
+        if (psf_sndWriteFloatFrames(ofd, frames, frames_read) != frames_read)
         {
             printf("Error writing to outfile\n");
             error++;
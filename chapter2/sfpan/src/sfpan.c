@@ -61,6 +61,7 @@ int main(int argc, char *argv[])
     int error = 0;
     psf_format outformat = PSF_FMT_UNKNOWN;
     float *inframe = NULL, *outframe = NULL;
+    double *positions = NULL; // Pan positions of one buffer of frames
     // Breakpoints
     FILE *fp = NULL;
     size_t points_count = 0;
@@ -170,24 +171,29 @@ int main(int argc, char *argv[])
         goto cleanup;
     }
 
+    positions = malloc(NFRAMES * sizeof(double));
+    if (positions == NULL)
+    {
+        printf("No memory\n");
+        error++;
+        goto cleanup;
+    }
+
     printf("Processing...\n");
 
     total_read = 0;          // total amount of frames read from input file
     int update_interval = 0; // essentially a loop counter
-    const double time_incr =
-        1.0 / inprops.srate;  // amount of seconds between samples
-    double sample_time = 0.0; // current time of sample
+    BRKSTREAM panstream; // Pan positions from the breakpoints
+    bps_init(&panstream, points, points_count, (size_t)inprops.srate);
     while ((frames_read = psf_sndReadFloatFrames(ifd, inframe, NFRAMES)) > 0)
     {
         // Panning
+        bps_fill(&panstream, positions, (size_t)frames_read);
         for (int i = 0, out_i = 0; i < frames_read; i++)
         {
-            double stereopos =
-                val_at_brktime(points, points_count, sample_time);
-            PANPOS thispos = constpower_pan(stereopos);
+            PANPOS thispos = constpower_pan(positions[i]);
             outframe[out_i++] = inframe[i] * thispos.left;
             outframe[out_i++] = inframe[i] * thispos.right;
-            sample_time += time_incr;
         }
 
         if (psf_sndWriteFloatFrames(ofd, outframe, frames_read) != frames_read)
@@ -221,6 +227,7 @@ cleanup:
         free(inframe);
     if (outframe)
         free(outframe);
+    free(positions);
     if (points)
         free(points);
     if (fp)
@@ -14,6 +14,17 @@ typedef struct oscil_t
 } OSCIL;
 typedef double (*tickfunc)(OSCIL *osc, double freq);
 typedef double (*pwmtickfunc)(OSCIL *osc, double freq, double pwmod);
+typedef void (*tickblockfunc)(OSCIL *osc, double freq, float *out, size_t n);
+
+// Sine engines of sine_block
+typedef enum sine_mode
+{
+    SINE_LIBM,       // sin(), exact
+    SINE_ROTATION,   // Recursive quadrature oscillator, max error 1e-10
+    SINE_POLYNOMIAL, // Minimax polynomial, max error 3.4e-9
+    SINE_TABLE,      // 4096 point interpolated table, max error 3.3e-7
+    SINE_NMODES
+} SINE_MODE;
 
 void oscil_init(OSCIL *osc, size_t sample_rate);
 OSCIL *new_oscil(size_t sample_rate);
@@ -22,4 +33,52 @@ double sqrtick(OSCIL *osc, double freq);
 double pwmtick(OSCIL *osc, double freq, double pwmod);
 double sawdtick(OSCIL *osc, double freq);
 double sawutick(OSCIL *osc, double freq);
-double tritick(OSCIL *osc, double freq);
\ No newline at end of file
+double tritick(OSCIL *osc, double freq);
+
+// Band-limited (polyBLEP and polyBLAMP) versions of the ticks above
+double blep_sqrtick(OSCIL *osc, double freq);
+double blep_pwmtick(OSCIL *osc, double freq, double pwmod);
+double blep_sawdtick(OSCIL *osc, double freq);
+double blep_sawutick(OSCIL *osc, double freq);
+double blep_tritick(OSCIL *osc, double freq);
+void blep_sqrtick_block(OSCIL *osc, double freq, float *out, size_t n);
+void blep_sawdtick_block(OSCIL *osc, double freq, float *out, size_t n);
+void blep_sawutick_block(OSCIL *osc, double freq, float *out, size_t n);
+void blep_tritick_block(OSCIL *osc, double freq, float *out, size_t n);
+
+// Fast sine engines, see SINE_MODE. The table is built by the first
+// oscil_init, or explicitly with sine_table_init.
+void sine_table_init(void);
+double sinetick_poly(OSCIL *osc, double freq);
+double sinetick_table(OSCIL *osc, double freq);
+void sine_block(OSCIL *osc, SINE_MODE mode, double freq, float *out, size_t n);
+void sine_fill_fm(OSCIL *osc, SINE_MODE mode, const double *freqs, float *out,
+                  size_t n);
+// Names of the engines for the -e option, and the engine named name or
+// SINE_NMODES if there is none
+extern const char *const sine_mode_names[SINE_NMODES];
+SINE_MODE sine_mode_named(const char *name);
+
+// Waveforms of the block generators
+typedef enum waveform
+{
+    WAVEFORM_SINE,
+    WAVEFORM_TRIANGLE,
+    WAVEFORM_SAW_UP,
+    WAVEFORM_SAW_DOWN,
+    WAVEFORM_SQUARE,
+    WAVEFORM_NFORMS
+} WAVEFORM;
+
+// Block generators, producing the samples of the ticks above
+void oscil_fill(OSCIL *osc, WAVEFORM waveform, double freq, float *out,
+                size_t n);
+void oscil_fill_fm(OSCIL *osc, WAVEFORM waveform, const double *freqs,
+                   float *out, size_t n);
+void pwm_fill(OSCIL *osc, const double *freqs, const double *pwmods,
+              float *out, size_t n);
+// Block generators of the band-limited ticks
+void blep_fill_fm(OSCIL *osc, WAVEFORM waveform, const double *freqs,
+                  float *out, size_t n);
+void blep_pwm_fill(OSCIL *osc, const double *freqs, const double *pwmods,
+                   float *out, size_t n);
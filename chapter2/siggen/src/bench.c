@@ -0,0 +1,211 @@
+/*
+ * Benchmark for siggen's waveforms: naive, band-limited (polyBLEP) and
+ * additive versions, with the level of their aliasing, and the sine engines
+ * Usage: bench
+ */
+#include "wave.h"
+#include <stdio.h>
+#include <time.h>
+
+#define SRATE 44100
+#define NSAMPLES (SRATE * 10)
+#define SINE_BLOCK 1024
+
+enum
+{
+    BENCH_SQUARE,
+    BENCH_SAW_DOWN,
+    BENCH_TRIANGLE,
+    BENCH_NFORMS
+};
+
+static const char *names[BENCH_NFORMS] = {"square", "saw down", "triangle"};
+static const tickfunc naive_ticks[BENCH_NFORMS] = {sqrtick, sawdtick,
+                                                   tritick};
+static const tickfunc blep_ticks[BENCH_NFORMS] = {blep_sqrtick, blep_sawdtick,
+                                                  blep_tritick};
+static const tickblockfunc blep_blocks[BENCH_NFORMS] = {
+    blep_sqrtick_block, blep_sawdtick_block, blep_tritick_block};
+
+static double elapsed_ns(clock_t start)
+{
+    return (clock() - start) * 1e9 / CLOCKS_PER_SEC / NSAMPLES;
+}
+
+/*
+ * Render the waveform by summing one sine oscillator per harmonic below
+ * Nyquist, like oscgen does. Returns the number of oscillators, or 0 if out
+ * of memory.
+ */
+static size_t additive(int form, double freq, float *out)
+{
+    size_t step = form == BENCH_SAW_DOWN ? 1 : 2; // Square, triangle: odd
+    size_t noscs = 0;
+    while ((1 + noscs * step) * freq < SRATE / 2.0)
+        ++noscs;
+    OSCIL *oscs = malloc(noscs * sizeof(OSCIL));
+    double *amps = malloc(noscs * sizeof(double));
+    if (oscs == NULL || amps == NULL)
+    {
+        free(oscs);
+        free(amps);
+        return 0;
+    }
+    for (size_t i = 0; i < noscs; ++i)
+    {
+        double k = (double)(1 + i * step);
+        oscil_init(&oscs[i], SRATE);
+        if (form == BENCH_TRIANGLE) // Cosine phase
+        {
+            oscs[i].current_phase = M_PI / 2;
+            amps[i] = 8.0 / (M_PI * M_PI * k * k);
+        }
+        else
+            amps[i] = (form == BENCH_SQUARE ? 4.0 : 2.0) / (M_PI * k);
+    }
+    for (size_t n = 0; n < NSAMPLES; ++n)
+    {
+        double val = 0.0;
+        for (size_t i = 0; i < noscs; ++i)
+            val += amps[i] * sinetick(&oscs[i], freq * (1 + i * step));
+        out[n] = (float)val;
+    }
+    free(oscs);
+    free(amps);
+    return noscs;
+}
+
+/*
+ * Ratio of harmonic to inharmonic energy of out in dB, freq having a whole
+ * number of cycles in NSAMPLES. The harmonics below Nyquist are orthogonal
+ * over the buffer, so their energies are the squared projections on them,
+ * and whatever remains (save DC) is aliasing.
+ */
+static double signal_to_alias_db(const float *out, double freq)
+{
+    double total = 0.0, mean = 0.0;
+    for (size_t n = 0; n < NSAMPLES; ++n)
+    {
+        total += (double)out[n] * out[n];
+        mean += out[n];
+    }
+    mean /= NSAMPLES;
+
+    double harmonic = 0.0;
+    for (double f = freq; f < SRATE / 2.0; f += freq)
+    {
+        // Rotate (re, im) by the harmonic's phase step instead of sin()
+        double step_re = cos(TWOPI * f / SRATE);
+        double step_im = sin(TWOPI * f / SRATE);
+        double re = 1.0, im = 0.0, c = 0.0, s = 0.0;
+        for (size_t n = 0; n < NSAMPLES; ++n)
+        {
+            c += out[n] * re;
+            s += out[n] * im;
+            double next_re = re * step_re - im * step_im;
+            im = re * step_im + im * step_re;
+            re = next_re;
+        }
+        harmonic += 2.0 * (c * c + s * s) / NSAMPLES;
+    }
+    double alias = total - mean * mean * NSAMPLES - harmonic;
+    if (alias <= 0.0) // Below rounding error
+        return INFINITY;
+    return 10.0 * log10(harmonic / alias);
+}
+
+/*
+ * Time sinetick against the block sine engines at freq, and report their
+ * largest difference to sin() (including rounding to float)
+ */
+static void bench_sines(double freq, float *reference, float *out)
+{
+    OSCIL osc;
+    oscil_init(&osc, SRATE);
+    clock_t start = clock();
+    for (size_t n = 0; n < NSAMPLES; ++n)
+        reference[n] = (float)sinetick(&osc, freq);
+    printf("%-10s %8.1f %10.2f ns\n", "sinetick", freq, elapsed_ns(start));
+
+    for (int mode = 0; mode < SINE_NMODES; ++mode)
+    {
+        oscil_init(&osc, SRATE);
+        start = clock();
+        for (size_t n = 0; n < NSAMPLES; n += SINE_BLOCK)
+            sine_block(&osc, (SINE_MODE)mode, freq, out + n,
+                       NSAMPLES - n < SINE_BLOCK ? NSAMPLES - n : SINE_BLOCK);
+        double ns = elapsed_ns(start);
+        double max_error = 0.0;
+        for (size_t n = 0; n < NSAMPLES; ++n)
+            if (fabs(out[n] - reference[n]) > max_error)
+                max_error = fabs(out[n] - reference[n]);
+        printf("%-10s %8.1f %10.2f ns %12.3g\n", sine_mode_names[mode], freq,
+               ns, max_error);
+    }
+}
+
+int main(void)
+{
+    // The test frequencies have whole numbers of cycles in NSAMPLES
+    float *reference = malloc(NSAMPLES * sizeof(float));
+    float *out = malloc(NSAMPLES * sizeof(float));
+    if (reference == NULL || out == NULL)
+    {
+        printf("No memory\n");
+        free(reference);
+        free(out);
+        return EXIT_FAILURE;
+    }
+
+    printf("%d samples, ns/sample and signal to alias ratio\n", NSAMPLES);
+    printf("%-9s %7s %17s %17s %17s %18s\n", "waveform", "freq", "naive",
+           "polyblep", "polyblep block", "additive");
+    for (int form = 0; form < BENCH_NFORMS; ++form)
+    {
+        for (double freq = 261.6; freq < 5000.0; freq *= 4.0)
+        {
+            clock_t start = clock();
+            size_t noscs = additive(form, freq, reference);
+            double additive_ns = elapsed_ns(start);
+            double additive_sar = signal_to_alias_db(reference, freq);
+            if (noscs == 0)
+            {
+                printf("No memory\n");
+                break;
+            }
+
+            double ns[3], sar[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                OSCIL osc;
+                oscil_init(&osc, SRATE);
+                start = clock();
+                if (k == 2)
+                    blep_blocks[form](&osc, freq, out, NSAMPLES);
+                else
+                {
+                    tickfunc tick =
+                        k == 0 ? naive_ticks[form] : blep_ticks[form];
+                    for (size_t n = 0; n < NSAMPLES; ++n)
+                        out[n] = (float)tick(&osc, freq);
+                }
+                ns[k] = elapsed_ns(start);
+                sar[k] = signal_to_alias_db(out, freq);
+            }
+            printf("%-9s %7.1f %6.2f ns %5.1f dB %6.2f ns %5.1f dB %6.2f ns "
+                   "%5.1f dB %7.2f ns %5.1f dB (%zu oscs)\n",
+                   names[form], freq, ns[0], sar[0], ns[1], sar[1], ns[2],
+                   sar[2], additive_ns, additive_sar, noscs);
+        }
+    }
+
+    printf("\nSine engines, %d samples in blocks of %d\n", NSAMPLES,
+           SINE_BLOCK);
+    printf("%-10s %8s %13s %12s\n", "engine", "freq", "time/sample",
+           "max error");
+    for (double freq = 261.6; freq < 5000.0; freq *= 4.0)
+        bench_sines(freq, reference, out);
+    free(reference);
+    free(out);
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,9 @@
 #include "breakpoints.h"
+#include "kernels.h"
 #include "wave.h"
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 #define NFRAMES 1024
 #define ON_FOPEN_ERROR(file, filename)                                         \
@@ -39,23 +41,76 @@ enum
     WAVE_NFORMS
 };
 
-tickfunc tick_functions[] = {sinetick, tritick, sawutick, sawdtick, sqrtick};
+// Block generator waveforms of the waveform argument, except PWM square
+WAVEFORM waveforms[] = {WAVEFORM_SINE, WAVEFORM_TRIANGLE, WAVEFORM_SAW_UP,
+                        WAVEFORM_SAW_DOWN, WAVEFORM_SQUARE};
 
 int main(int argc, char *argv[])
 {
     printf("siggen: generate simple tones\n");
     int error = 0; // positive if errors present
     PSF_PROPS outprops;
+    float *samples = NULL; // One channel of the output buffer
+    double *amps = NULL, *freqs = NULL, *pwmods = NULL; // Breakpoint values
 
     // Convert and validate arguments
+    if (kernels_args(&argc, argv))
+        return EXIT_FAILURE;
+    double start = 0.0; // Time in the breakpoint files to start from
+    SINE_MODE sine_mode = SINE_LIBM; // Engine of the sine waveform
+    int band_limited = 0; // Use the polyBLEP versions of the waveforms
+    while (argc > 1 && argv[1][0] == '-')
+    {
+        int shift = 2; // Arguments taken by the option
+        if (strcmp(argv[1], "-B") == 0)
+        {
+            band_limited = 1;
+            shift = 1;
+        }
+        else if (argc < 3)
+        {
+            printf("Error: option %s needs a value\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        else if (strcmp(argv[1], "-s") == 0)
+        {
+            start = strtod(argv[2], NULL);
+            if (start < 0.0)
+            {
+                printf("Error: start time must not be negative, was %lf\n",
+                       start);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[1], "-e") == 0)
+        {
+            sine_mode = sine_mode_named(argv[2]);
+            if (sine_mode == SINE_NMODES)
+            {
+                printf("Error: unknown sine engine %s\n", argv[2]);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            printf("Error: unknown option %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        argc -= shift;
+        argv += shift;
+    }
     if (argc < ARG_NARGS - 1)
     {
         printf(
-            "Error: insufficient arguments\nUsage: siggen outfile waveform"
-            " duration sample_rate channels freq_brkfile amp_brkfile "
-            "[pwmod_brkfile]\nWhere waveform is one of:\n0 - sine\n1 - "
-            "triangle\n2 - sawtooth (up)\n 3 - sawtooth (down)\n4 - "
-            "square\n5 - square w/PWM\nIf 5 is chosen, pwmod must be given\n");
+            "Error: insufficient arguments\nUsage: siggen [--kernel name] [-s "
+            "start] [-e engine] [-B] outfile waveform duration sample_rate "
+            "channels freq_brkfile amp_brkfile [pwmod_brkfile]\nWhere "
+            "waveform is one of:\n0 - sine\n1 - triangle\n2 - sawtooth "
+            "(up)\n 3 - sawtooth (down)\n4 - square\n5 - square w/PWM\nIf 5 "
+            "is chosen, pwmod must be given\n-s:\tstart from start seconds "
+            "into the breakpoint files\n-e:\tsine engine, one of libm "
+            "(default), rotation, polynomial and table\n-B:\tband-limit the "
+            "waveforms with polyBLEP\n");
         return EXIT_FAILURE;
     }
 
@@ -76,11 +131,6 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    tickfunc tick = NULL;
-    // PWM square wave has a different function signature
-    if (waveform_type != WAVE_PWM_SQUARE)
-        tick = tick_functions[waveform_type];
-
     outprops.chans = (int)strtol(argv[ARG_CHANNELS], NULL, 10);
     if (outprops.chans < 1)
     {
@@ -185,46 +235,57 @@ int main(int argc, char *argv[])
         goto cleanup;
     }
 
+    bps_seek(freq_stream, start);
+    bps_seek(ampstream, start);
+    bps_seek(pwm_stream, start);
+
     OSCIL *osc = new_oscil(outprops.srate);
 
     size_t outframes =
-        (size_t)(duration * outprops.srate + 0.5);  // Number of output frames
-    size_t nbufs = outframes / (NFRAMES);           // Number of buffers to fill
-    size_t remainder = outframes - nbufs * NFRAMES; // Count of remaining frames
-    if (remainder > 0)
-        ++nbufs;
+        (size_t)(duration * outprops.srate + 0.5); // Number of output frames
 
     float *outframe = malloc(outprops.chans * NFRAMES * sizeof(float));
-    if (outframe == NULL)
+    samples = malloc(NFRAMES * sizeof(float));
+    amps = malloc(NFRAMES * sizeof(double));
+    freqs = malloc(NFRAMES * sizeof(double));
+    pwmods = malloc(NFRAMES * sizeof(double));
+    if (outframe == NULL || samples == NULL || amps == NULL || freqs == NULL ||
+        pwmods == NULL)
     {
         printf("No memory\n");
         error++;
         goto cleanup;
     }
 
-    // Processing
-    unsigned int nframes =
-        outprops.chans * NFRAMES; // Number of frames in buffer
-    for (size_t i = 0; i < nbufs; i++)
+    // Processing, one buffer of breakpoint values and samples at a time
+    for (size_t done = 0; done < outframes; done += NFRAMES)
     {
-        if (i == nbufs - 1) // make only remainder amount of samples on last run
-            nframes = remainder;
-        for (unsigned int j = 0; j < nframes; j += outprops.chans)
+        unsigned nframes =
+            outframes - done < NFRAMES ? (unsigned)(outframes - done) : NFRAMES;
+        bps_fill(ampstream, amps, nframes);
+        bps_fill(freq_stream, freqs, nframes);
+        bps_fill(pwm_stream, pwmods, nframes);
+        if (waveform_type == WAVE_PWM_SQUARE && band_limited)
+            blep_pwm_fill(osc, freqs, pwmods, samples, nframes);
+        else if (waveform_type == WAVE_PWM_SQUARE)
+            pwm_fill(osc, freqs, pwmods, samples, nframes);
+        else if (waveform_type == WAVE_SINE)
+            sine_fill_fm(osc, sine_mode, freqs, samples, nframes);
+        else if (band_limited)
+            blep_fill_fm(osc, waveforms[waveform_type], freqs, samples,
+                         nframes);
+        else
+            oscil_fill_fm(osc, waveforms[waveform_type], freqs, samples,
+                          nframes);
+        for (unsigned j = 0, k = 0; j < nframes; j++)
         {
-            double amplitude = bps_tick(ampstream);
-            double frequency = bps_tick(freq_stream);
-            double pwmod = bps_tick(pwm_stream);
-            float sample_value =
-                waveform_type == WAVE_PWM_SQUARE
-                    ? (float)(amplitude * pwmtick(osc, frequency, pwmod))
-                    : (float)(amplitude * tick(osc, frequency));
+            float sample_value = (float)(amps[j] * samples[j]);
             for (unsigned chan = 0; chan < (unsigned)outprops.chans; chan++)
-                outframe[j + chan] = sample_value;
+                outframe[k++] = sample_value;
         }
 
-        int written_frames =
-            psf_sndWriteFloatFrames(ofd, outframe, nframes / outprops.chans);
-        if (written_frames != (int)nframes / outprops.chans)
+        int written_frames = psf_sndWriteFloatFrames(ofd, outframe, nframes);
+        if (written_frames != (int)nframes)
         {
             printf("Error writing to outfile\n");
             error++;
@@ -240,6 +301,10 @@ cleanup:
         psf_sndClose(ofd);
     if (outframe)
         free(outframe);
+    free(samples);
+    free(amps);
+    free(freqs);
+    free(pwmods);
     if (osc)
         free(osc);
     if (ampstream)
@@ -1,11 +1,16 @@
 #include "wave.h"
+#include "kernels.h"
 #include <stdio.h> // DEBUG:
+#include <string.h>
+
+#define FILL_CHUNK 256 // Samples per phase buffer
 
 /*
  * Initialize an oscillator object
  */
 void oscil_init(OSCIL *osc, size_t sample_rate)
 {
+    sine_table_init();
     osc->two_pi_over_srate = TWOPI / (double)sample_rate;
     osc->current_phase = 0.0;
     osc->current_freq = 0.0;
@@ -154,3 +159,637 @@ double tritick(OSCIL *osc, double freq)
         osc->current_phase += TWOPI;
     return val;
 }
+
+/*
+ * Band-limited waveforms. The naive waveforms jump (square, saw) or bend
+ * (triangle) between samples, and the infinitely many harmonics of those
+ * corners alias. polyBLEP and polyBLAMP subtract a two sample polynomial
+ * approximation of that residual around every corner, which suppresses
+ * aliasing strongly for a handful of flops per sample. Phases t and
+ * increments dt are in cycles here.
+ */
+
+// Update the phase increment of osc for frequency freq
+static void set_frequency(OSCIL *osc, double freq)
+{
+    if (osc->current_freq != freq)
+    {
+        osc->current_freq = freq;
+        osc->phase_increment = osc->two_pi_over_srate * freq;
+    }
+}
+
+// Advance osc by one sample
+static void advance_phase(OSCIL *osc)
+{
+    osc->current_phase += osc->phase_increment;
+    if (osc->current_phase >= TWOPI)
+        osc->current_phase -= TWOPI;
+    if (osc->current_phase < 0.0)
+        osc->current_phase += TWOPI;
+}
+
+/*
+ * Residual of a unit step (height 2) at t = 0, band-limited over one
+ * sample on each side
+ */
+static inline double poly_blep(double t, double dt)
+{
+    if (t < dt)
+    {
+        t /= dt;
+        return t + t - t * t - 1.0;
+    }
+    if (t > 1.0 - dt)
+    {
+        t = (t - 1.0) / dt;
+        return t * t + t + t + 1.0;
+    }
+    return 0.0;
+}
+
+/*
+ * Residual of a unit change of slope per sample at t = 0, the integral of
+ * poly_blep
+ */
+static inline double poly_blamp(double t, double dt)
+{
+    if (t < dt)
+    {
+        t = t / dt - 1.0;
+        return -1.0 / 3.0 * t * t * t;
+    }
+    if (t > 1.0 - dt)
+    {
+        t = (t - 1.0) / dt + 1.0;
+        return 1.0 / 3.0 * t * t * t;
+    }
+    return 0.0;
+}
+
+static inline double wrap_cycle(double t) { return t >= 1.0 ? t - 1.0 : t; }
+
+static inline double blep_sawd_value(double t, double dt)
+{
+    return 1.0 - 2.0 * t + poly_blep(t, dt);
+}
+
+static inline double blep_sawu_value(double t, double dt)
+{
+    return 2.0 * t - 1.0 - poly_blep(t, dt);
+}
+
+// Pulse rising at t = 0 and falling at t = width
+static inline double blep_pulse_value(double t, double dt, double width)
+{
+    double val = t <= width ? 1.0 : -1.0;
+    return val + poly_blep(t, dt) - poly_blep(wrap_cycle(t - width + 1.0), dt);
+}
+
+// Triangle falling from 1 at t = 0 to -1 at t = 0.5, slope 4 per cycle
+static inline double blep_tri_value(double t, double dt)
+{
+    double val = 2.0 * fabs(2.0 * t - 1.0) - 1.0;
+    return val + 4.0 * dt *
+                     (poly_blamp(wrap_cycle(t + 0.5), dt) - poly_blamp(t, dt));
+}
+
+/**
+ * Band-limited square wave
+ */
+double blep_sqrtick(OSCIL *osc, double freq)
+{
+    set_frequency(osc, freq);
+    double dt = fabs(osc->phase_increment) * (1.0 / TWOPI);
+    double val = blep_pulse_value(osc->current_phase * (1.0 / TWOPI), dt, 0.5);
+    advance_phase(osc);
+    return val;
+}
+
+/**
+ * Band-limited square wave with pulsewidth according to parameter pwmod
+ */
+double blep_pwmtick(OSCIL *osc, double freq, double pwmod)
+{
+    if (pwmod > 0.99)
+        pwmod = 0.99;
+    if (pwmod < 0.01)
+        pwmod = 0.01;
+    set_frequency(osc, freq);
+    double dt = fabs(osc->phase_increment) * (1.0 / TWOPI);
+    double val =
+        blep_pulse_value(osc->current_phase * (1.0 / TWOPI), dt, pwmod);
+    advance_phase(osc);
+    return val;
+}
+
+/**
+ * Band-limited downward sawtooth wave
+ */
+double blep_sawdtick(OSCIL *osc, double freq)
+{
+    set_frequency(osc, freq);
+    double dt = fabs(osc->phase_increment) * (1.0 / TWOPI);
+    double val = blep_sawd_value(osc->current_phase * (1.0 / TWOPI), dt);
+    advance_phase(osc);
+    return val;
+}
+
+/**
+ * Band-limited upward sawtooth wave
+ */
+double blep_sawutick(OSCIL *osc, double freq)
+{
+    set_frequency(osc, freq);
+    double dt = fabs(osc->phase_increment) * (1.0 / TWOPI);
+    double val = blep_sawu_value(osc->current_phase * (1.0 / TWOPI), dt);
+    advance_phase(osc);
+    return val;
+}
+
+/**
+ * Band-limited triangle wave
+ */
+double blep_tritick(OSCIL *osc, double freq)
+{
+    set_frequency(osc, freq);
+    double dt = fabs(osc->phase_increment) * (1.0 / TWOPI);
+    double val = blep_tri_value(osc->current_phase * (1.0 / TWOPI), dt);
+    advance_phase(osc);
+    return val;
+}
+
+/*
+ * Block forms: fill out with the next n samples of the tick at constant
+ * frequency freq. The phase is kept in cycles in a local variable, and the
+ * oscillator is updated once per block.
+ */
+#define BLEP_BLOCK(name, value_expr)                                           \
+    void name(OSCIL *osc, double freq, float *out, size_t n)                   \
+    {                                                                          \
+        set_frequency(osc, freq);                                              \
+        double t = osc->current_phase * (1.0 / TWOPI);                         \
+        double inc = osc->phase_increment * (1.0 / TWOPI);                     \
+        double dt = fabs(inc);                                                 \
+        for (size_t i = 0; i < n; ++i)                                         \
+        {                                                                      \
+            out[i] = (float)(value_expr);                                      \
+            t += inc;                                                          \
+            if (t >= 1.0)                                                      \
+                t -= 1.0;                                                      \
+            if (t < 0.0)                                                       \
+                t += 1.0;                                                      \
+        }                                                                      \
+        osc->current_phase = t * TWOPI;                                        \
+    }
+
+BLEP_BLOCK(blep_sqrtick_block, blep_pulse_value(t, dt, 0.5))
+BLEP_BLOCK(blep_sawdtick_block, blep_sawd_value(t, dt))
+BLEP_BLOCK(blep_sawutick_block, blep_sawu_value(t, dt))
+BLEP_BLOCK(blep_tritick_block, blep_tri_value(t, dt))
+
+/*
+ * Fast sine engines. All of them follow the phase of sinetick exactly and
+ * differ only in how the sine of the phase is evaluated.
+ */
+
+#define SINE_TABLE_SIZE 4096
+#define RENORMALIZE_INTERVAL 256 // Samples between rotation renormalizations
+
+static float sine_table[SINE_TABLE_SIZE + 1]; // With guard point
+static int sine_table_ready = 0;
+
+const char *const sine_mode_names[SINE_NMODES] = {"libm", "rotation",
+                                                  "polynomial", "table"};
+
+SINE_MODE sine_mode_named(const char *name)
+{
+    int mode = 0;
+    while (mode < SINE_NMODES && strcmp(sine_mode_names[mode], name) != 0)
+        mode++;
+    return (SINE_MODE)mode;
+}
+
+void sine_table_init(void)
+{
+    if (sine_table_ready)
+        return;
+    for (size_t i = 0; i <= SINE_TABLE_SIZE; ++i)
+        sine_table[i] = (float)sin(TWOPI * i / SINE_TABLE_SIZE);
+    sine_table_ready = 1;
+}
+
+/*
+ * Odd minimax polynomial of degree 9 for sin on [-pi/2, pi/2], max error
+ * 3.4e-9. The phase in [0, 2pi) is first reflected into that range.
+ */
+static inline double sine_poly(double phase)
+{
+    double x = phase;
+    if (x > 1.5 * M_PI)
+        x -= TWOPI;
+    else if (x > 0.5 * M_PI)
+        x = M_PI - x;
+    double x2 = x * x;
+    return x * (0.999999976589883 +
+                x2 * (-0.166666476346403 +
+                      x2 * (0.008332899823360418 +
+                            x2 * (-0.00019800897763281068 +
+                                  x2 * 2.590488501433902e-06))));
+}
+
+// Linearly interpolated lookup of a phase in [0, 2pi)
+static inline double sine_lookup(double phase)
+{
+    double position = phase * (SINE_TABLE_SIZE / TWOPI);
+    int index = (int)position;
+    if (index > SINE_TABLE_SIZE - 1) // A phase just below 2pi may round up
+        index = SINE_TABLE_SIZE - 1;
+    double fraction = position - index;
+    return sine_table[index] +
+           fraction * (sine_table[index + 1] - sine_table[index]);
+}
+
+/**
+ * sinetick evaluating the sine with a polynomial, max error 3.4e-9
+ */
+double sinetick_poly(OSCIL *osc, double freq)
+{
+    double val = sine_poly(osc->current_phase);
+    set_frequency(osc, freq);
+    advance_phase(osc);
+    return val;
+}
+
+/**
+ * sinetick reading a linearly interpolated table, max error 3.3e-7
+ */
+double sinetick_table(OSCIL *osc, double freq)
+{
+    double val = sine_lookup(osc->current_phase);
+    set_frequency(osc, freq);
+    advance_phase(osc);
+    return val;
+}
+
+/*
+ * Fill out with n samples of a sine at frequency freq. SINE_ROTATION turns
+ * a unit vector by the phase increment every sample, two multiply-adds per
+ * sample. Its rounding errors accumulate, so the vector is renormalized
+ * every RENORMALIZE_INTERVAL samples and taken again from the phase at the
+ * start of every block.
+ */
+void sine_block(OSCIL *osc, SINE_MODE mode, double freq, float *out, size_t n)
+{
+    set_frequency(osc, freq);
+    double phase = osc->current_phase, increment = osc->phase_increment;
+    switch (mode)
+    {
+    case SINE_ROTATION:
+    {
+        double re = cos(phase), im = sin(phase);
+        double step_re = cos(increment), step_im = sin(increment);
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = (float)im;
+            double next_re = re * step_re - im * step_im;
+            im = re * step_im + im * step_re;
+            re = next_re;
+            if (i % RENORMALIZE_INTERVAL == RENORMALIZE_INTERVAL - 1)
+            {
+                // First order correction of the magnitude towards 1
+                double scale = 1.5 - 0.5 * (re * re + im * im);
+                re *= scale;
+                im *= scale;
+            }
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        break;
+    }
+    case SINE_POLYNOMIAL:
+    {
+        // The polynomial of a chunk of phases is evaluated by the vector
+        // kernel the CPU supports
+        double phases[FILL_CHUNK];
+        for (size_t done = 0; done < n; done += FILL_CHUNK)
+        {
+            size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+            for (size_t i = 0; i < count; ++i)
+            {
+                phases[i] = phase;
+                phase += increment;
+                if (phase >= TWOPI)
+                    phase -= TWOPI;
+                if (phase < 0.0)
+                    phase += TWOPI;
+            }
+            kernels()->sine(out + done, phases, count);
+        }
+        break;
+    }
+    case SINE_TABLE:
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = (float)sine_lookup(phase);
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = (float)sin(phase);
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        break;
+    }
+    osc->current_phase = phase;
+}
+
+/*
+ * Block generators. The phases of a chunk are computed first, exactly as
+ * the ticks advance them, and the waveform is then evaluated in a loop of
+ * its own, so there is no call per sample.
+ */
+
+/*
+ * Write the phases of the next n (at most FILL_CHUNK) samples to phases and
+ * advance osc past them, at frequency freqs[i] for sample i or at constant
+ * frequency freq if freqs is NULL
+ */
+static void fill_phases(OSCIL *osc, double freq, const double *freqs,
+                        double *phases, size_t n)
+{
+    double phase = osc->current_phase;
+    if (freqs)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            phases[i] = phase;
+            phase += osc->two_pi_over_srate * freqs[i];
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        // Later ticks continue from the last frequency
+        set_frequency(osc, freqs[n - 1]);
+    }
+    else
+    {
+        set_frequency(osc, freq);
+        double increment = osc->phase_increment;
+        for (size_t i = 0; i < n; ++i)
+        {
+            phases[i] = phase;
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+    }
+    osc->current_phase = phase;
+}
+
+// Evaluate waveform at n phases, the same way its tick does
+static void waveform_values(WAVEFORM waveform, const double *phases,
+                            float *out, size_t n)
+{
+    switch (waveform)
+    {
+    case WAVEFORM_SINE:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = (float)sin(phases[i]);
+        break;
+    case WAVEFORM_TRIANGLE:
+        for (size_t i = 0; i < n; ++i)
+        {
+            double val = fabs((2.0 * (phases[i] * (1.0 / TWOPI))) - 1.0);
+            out[i] = (float)(2.0 * (val - 0.5));
+        }
+        break;
+    case WAVEFORM_SAW_UP:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = (float)((2.0 * (phases[i] * (1.0 / TWOPI))) - 1.0);
+        break;
+    case WAVEFORM_SAW_DOWN:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = (float)(1.0 - 2.0 * (phases[i] * (1.0 / TWOPI)));
+        break;
+    case WAVEFORM_SQUARE:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = phases[i] <= M_PI ? 1.f : -1.f;
+        break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = 0.f;
+        break;
+    }
+}
+
+static void fill(OSCIL *osc, WAVEFORM waveform, double freq,
+                 const double *freqs, float *out, size_t n)
+{
+    double phases[FILL_CHUNK];
+    for (size_t done = 0; done < n; done += FILL_CHUNK)
+    {
+        size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+        fill_phases(osc, freq, freqs ? freqs + done : NULL, phases, count);
+        waveform_values(waveform, phases, out + done, count);
+    }
+}
+
+/**
+ * Fill out with the next n samples of waveform at frequency freq
+ */
+void oscil_fill(OSCIL *osc, WAVEFORM waveform, double freq, float *out,
+                size_t n)
+{
+    fill(osc, waveform, freq, NULL, out, n);
+}
+
+/**
+ * Fill out with the next n samples of waveform, at frequency freqs[i] for
+ * sample i
+ */
+void oscil_fill_fm(OSCIL *osc, WAVEFORM waveform, const double *freqs,
+                   float *out, size_t n)
+{
+    fill(osc, waveform, 0.0, freqs, out, n);
+}
+
+/**
+ * Fill out with the next n samples of a sine by engine mode, at frequency
+ * freqs[i] for sample i. SINE_ROTATION takes a new step whenever the
+ * frequency changes, so it only pays off for runs of a constant frequency.
+ */
+void sine_fill_fm(OSCIL *osc, SINE_MODE mode, const double *freqs, float *out,
+                  size_t n)
+{
+    if (n == 0)
+        return;
+    if (mode == SINE_ROTATION)
+    {
+        double phase = osc->current_phase;
+        double re = cos(phase), im = sin(phase);
+        double freq = freqs[0], increment = osc->two_pi_over_srate * freq;
+        double step_re = cos(increment), step_im = sin(increment);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (freqs[i] != freq)
+            {
+                freq = freqs[i];
+                increment = osc->two_pi_over_srate * freq;
+                step_re = cos(increment);
+                step_im = sin(increment);
+            }
+            out[i] = (float)im;
+            double next_re = re * step_re - im * step_im;
+            im = re * step_im + im * step_re;
+            re = next_re;
+            if (i % RENORMALIZE_INTERVAL == RENORMALIZE_INTERVAL - 1)
+            {
+                double scale = 1.5 - 0.5 * (re * re + im * im);
+                re *= scale;
+                im *= scale;
+            }
+            phase += increment;
+            if (phase >= TWOPI)
+                phase -= TWOPI;
+            if (phase < 0.0)
+                phase += TWOPI;
+        }
+        osc->current_phase = phase;
+        set_frequency(osc, freq);
+        return;
+    }
+
+    double phases[FILL_CHUNK];
+    for (size_t done = 0; done < n; done += FILL_CHUNK)
+    {
+        size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+        fill_phases(osc, 0.0, freqs + done, phases, count);
+        switch (mode)
+        {
+        case SINE_POLYNOMIAL:
+            kernels()->sine(out + done, phases, count);
+            break;
+        case SINE_TABLE:
+            for (size_t i = 0; i < count; ++i)
+                out[done + i] = (float)sine_lookup(phases[i]);
+            break;
+        default:
+            for (size_t i = 0; i < count; ++i)
+                out[done + i] = (float)sin(phases[i]);
+            break;
+        }
+    }
+}
+
+/**
+ * Fill out with the next n samples of pwmtick, at frequency freqs[i] and
+ * pulse width pwmods[i] for sample i
+ */
+void pwm_fill(OSCIL *osc, const double *freqs, const double *pwmods,
+              float *out, size_t n)
+{
+    double phases[FILL_CHUNK];
+    for (size_t done = 0; done < n; done += FILL_CHUNK)
+    {
+        size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+        fill_phases(osc, 0.0, freqs + done, phases, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            double pwmod = pwmods[done + i];
+            if (pwmod > 0.99)
+                pwmod = 0.99;
+            if (pwmod < 0.01)
+                pwmod = 0.01;
+            out[done + i] = phases[i] <= M_PI * pwmod * 2 ? 1.f : -1.f;
+        }
+    }
+}
+
+/**
+ * Fill out with the next n samples of the band-limited tick of waveform, at
+ * frequency freqs[i] for sample i. The sine has no corners and is plain
+ * sinetick.
+ */
+void blep_fill_fm(OSCIL *osc, WAVEFORM waveform, const double *freqs,
+                  float *out, size_t n)
+{
+    double phases[FILL_CHUNK];
+    for (size_t done = 0; done < n; done += FILL_CHUNK)
+    {
+        size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+        fill_phases(osc, 0.0, freqs + done, phases, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            double t = phases[i] * (1.0 / TWOPI);
+            double dt =
+                fabs(osc->two_pi_over_srate * freqs[done + i]) * (1.0 / TWOPI);
+            double val;
+            switch (waveform)
+            {
+            case WAVEFORM_SINE:
+                val = sin(phases[i]);
+                break;
+            case WAVEFORM_TRIANGLE:
+                val = blep_tri_value(t, dt);
+                break;
+            case WAVEFORM_SAW_UP:
+                val = blep_sawu_value(t, dt);
+                break;
+            case WAVEFORM_SAW_DOWN:
+                val = blep_sawd_value(t, dt);
+                break;
+            case WAVEFORM_SQUARE:
+                val = blep_pulse_value(t, dt, 0.5);
+                break;
+            default:
+                val = 0.0;
+                break;
+            }
+            out[done + i] = (float)val;
+        }
+    }
+}
+
+/**
+ * Fill out with the next n samples of blep_pwmtick, at frequency freqs[i] and
+ * pulse width pwmods[i] for sample i
+ */
+void blep_pwm_fill(OSCIL *osc, const double *freqs, const double *pwmods,
+                   float *out, size_t n)
+{
+    double phases[FILL_CHUNK];
+    for (size_t done = 0; done < n; done += FILL_CHUNK)
+    {
+        size_t count = n - done < FILL_CHUNK ? n - done : FILL_CHUNK;
+        fill_phases(osc, 0.0, freqs + done, phases, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            double pwmod = pwmods[done + i];
+            if (pwmod > 0.99)
+                pwmod = 0.99;
+            if (pwmod < 0.01)
+                pwmod = 0.01;
+            double dt =
+                fabs(osc->two_pi_over_srate * freqs[done + i]) * (1.0 / TWOPI);
+            out[done + i] = (float)blep_pulse_value(
+                phases[i] * (1.0 / TWOPI), dt, pwmod);
+        }
+    }
+}
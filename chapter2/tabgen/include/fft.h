@@ -0,0 +1,7 @@
+#pragma once
+#include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+bool is_power_of_two(size_t n);
+void fft(double complex *x, size_t n, bool inverse);
@@ -3,20 +3,42 @@
 
 typedef struct t_gtable
 {
-    double *table; // pointer to array containing the waveform
-    size_t length; // excluding guard point
+    double *table;      // pointer to array containing the waveform
+    size_t length;      // excluding guard point
+    size_t mapped_size; // non-zero if table is a read-only cache mapping
 } GTABLE;
 
+#define GTABLEF_GUARDS 3 // Guard points on both ends, enough for 6 points
+#define GTABLEF_ALIGN 64 // Byte alignment of the first sample of the cycle
+
+/*
+ * Lookup table of float samples. table[-GTABLEF_GUARDS] to
+ * table[length + GTABLEF_GUARDS - 1] are valid, the guard points repeating
+ * the other end of the cycle, so 4 and 6 point interpolation never wraps.
+ * Half the size of GTABLE for the same length.
+ */
+typedef struct t_gtablef
+{
+    float *table;  // first sample of the cycle, GTABLEF_ALIGN aligned
+    size_t length; // excluding guard points
+    void *block;   // allocation containing the table and its guard points
+} GTABLEF;
+
 /* Table lookup oscillator */
 typedef struct t_tab_oscil
 {
     OSCIL osc;
-    const GTABLE *gtable;
+    const GTABLE *gtable;   // double table, or NULL
+    const GTABLEF *gtablef; // float table, or NULL
     double dtablen;
     double size_over_srate;
 } OSCILT;
 
 typedef double (*oscilt_tickfunc)(OSCILT *osc, double freq);
+typedef void (*oscilt_blockfunc)(OSCILT *osc, double freq, float *out,
+                                 size_t n);
+typedef void (*oscilt_fmblockfunc)(OSCILT *osc, const double *freqs,
+                                   float *out, size_t n);
 
 typedef enum saw_direction
 {
@@ -24,12 +46,49 @@ typedef enum saw_direction
     SAW_UP
 } SAW_DIRECTION;
 
+// Waveforms of the table generators. The values are stored in the table
+// cache, so new ones are only appended.
+typedef enum gtable_waveform
+{
+    GTABLE_SINE,
+    GTABLE_TRIANGLE,
+    GTABLE_SQUARE,
+    GTABLE_SAW_DOWN,
+    GTABLE_SAW_UP,
+    GTABLE_NWAVEFORMS
+} GTABLE_WAVEFORM;
+
 GTABLE *new_gtable(size_t length);
 GTABLE *new_sine(size_t length);
+GTABLE *new_gtable_spectrum(size_t length, const double *amps,
+                            const double *phases, size_t nharmonics);
 GTABLE *new_triangle(size_t length, unsigned nharmonics);
 GTABLE *new_square(size_t length, unsigned nharmonics);
 GTABLE *new_saw(size_t length, size_t nharmonics, SAW_DIRECTION direction);
 void gtable_free(GTABLE **gtable);
+GTABLEF *new_gtablef(const GTABLE *gtable);
+void gtablef_free(GTABLEF **gtablef);
 OSCILT *new_oscilt(double srate, const GTABLE *gtable, double phase);
+OSCILT *new_oscilt_float(double srate, const GTABLEF *gtablef, double phase);
+
+// Single sample ticks, tabtick_cubic needs a float table and the rest double
 double tabtick_trunc(OSCILT *p_osc, double freq);
-double tabtick_interp(OSCILT *p_osc, double freq);
\ No newline at end of file
+double tabtick_interp(OSCILT *p_osc, double freq);
+double tabtick_cubic(OSCILT *p_osc, double freq);
+
+/*
+ * Block versions of the ticks: fill out with the next n samples, at constant
+ * frequency freq or at frequency freqs[i] for sample i. They produce the
+ * samples of n tick calls with the same frequencies, up to rounding.
+ * Truncating and interpolating block ticks read either table type, cubic
+ * ones need a float table.
+ */
+void tabtick_trunc_block(OSCILT *p_osc, double freq, float *out, size_t n);
+void tabtick_interp_block(OSCILT *p_osc, double freq, float *out, size_t n);
+void tabtick_trunc_block_fm(OSCILT *p_osc, const double *freqs, float *out,
+                            size_t n);
+void tabtick_interp_block_fm(OSCILT *p_osc, const double *freqs, float *out,
+                             size_t n);
+void tabtick_cubic_block(OSCILT *p_osc, double freq, float *out, size_t n);
+void tabtick_cubic_block_fm(OSCILT *p_osc, const double *freqs, float *out,
+                            size_t n);
@@ -0,0 +1,20 @@
+#pragma once
+#include "gtable.h"
+
+/*
+ * Process-wide registry of shared, immutable lookup tables. Any number of
+ * oscillators, in any thread, may read one table. A table is generated on
+ * its first acquire and freed on its last release, so ownership is simply
+ * one release per acquire.
+ */
+
+/*
+ * Table of waveform with length samples and nharmonics harmonics (ignored
+ * for sines), generated if no one holds it yet. Returns NULL if the table
+ * cannot be generated. Thread safe.
+ */
+const GTABLE *gtable_acquire(GTABLE_WAVEFORM waveform, size_t length,
+                             unsigned nharmonics);
+
+// Release a table returned by gtable_acquire. Thread safe.
+void gtable_release(const GTABLE *gtable);
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * On-disk cache of generated lookup tables. Every table is stored in its own
+ * file under $WAVETABLE_CACHE (or $XDG_CACHE_HOME/audioprogramming, or
+ * ~/.cache/audioprogramming) in a subdirectory per program, and mapped
+ * read-only when loaded, so that concurrent processes share one physical
+ * copy. Setting WAVETABLE_CACHE to an empty string disables the cache.
+ *
+ * File layout, native byte order:
+ *     char     magic[4]    "WTAB"
+ *     uint32_t version     TABCACHE_VERSION
+ *     uint32_t generator   bumped by the program when its tables change
+ *     uint32_t waveform    program specific waveform id
+ *     uint32_t nharmonics
+ *     uint32_t length      samples in one cycle
+ *     uint32_t nguards     guard points following the cycle
+ *     uint32_t samptype    TABCACHE_SAMPTYPE
+ *     length + nguards samples
+ * The 32 byte header keeps the samples aligned for doubles.
+ */
+
+#define TABCACHE_VERSION 1
+
+typedef enum tabcache_samptype
+{
+    TABCACHE_FLOAT32,
+    TABCACHE_FLOAT64
+} TABCACHE_SAMPTYPE;
+
+typedef struct tabcache_key
+{
+    const char *program; // Subdirectory of the cache
+    uint32_t generator;
+    uint32_t waveform;
+    uint32_t nharmonics;
+    uint32_t length;
+    uint32_t nguards;
+    TABCACHE_SAMPTYPE samptype;
+} TABCACHE_KEY;
+
+/*
+ * Map the table of key read-only. Returns a pointer to its samples and sets
+ * *mapped_size for tabcache_release, or returns NULL if the table is not
+ * cached or the cache is disabled.
+ */
+const void *tabcache_load(const TABCACHE_KEY *key, size_t *mapped_size);
+
+/*
+ * Store samples (length + nguards of them) as the table of key. The file is
+ * written under a temporary name and renamed into place, so readers never
+ * see a partial table. Returns 0 on success.
+ */
+int tabcache_store(const TABCACHE_KEY *key, const void *samples);
+
+// Unmap a table returned by tabcache_load
+void tabcache_release(const void *samples, size_t mapped_size);
+
+// Enable or disable the cache for this process, enabled by default
+void tabcache_enable(bool enable);
@@ -0,0 +1,173 @@
+/*
+ * Benchmark for tabgen's table generation
+ * Usage: bench
+ */
+#include "gtable.h"
+#include "tabcache.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+// Saw table by direct summation of sines, as done before FFT synthesis
+static GTABLE *new_saw_direct(size_t length, size_t nharmonics)
+{
+    GTABLE *gtable = new_gtable(length);
+    if (gtable == NULL)
+        return NULL;
+    const double step = TWOPI / length;
+    for (size_t harmonic = 1; harmonic <= nharmonics; ++harmonic)
+    {
+        double amplitude = 1.0 / harmonic;
+        for (size_t j = 0; j < length; ++j)
+            gtable->table[j] += amplitude * sin(j * step * harmonic);
+    }
+    return gtable;
+}
+
+static double elapsed_ms(clock_t start)
+{
+    return (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+#define TICK_FRAMES (44100 * 60)
+#define TICK_BUF 1024
+
+// Time TICK_FRAMES samples of single sample ticks and of block ticks
+static void bench_ticks(const GTABLE *gtable)
+{
+    static float out[TICK_BUF];
+    static double freqs[TICK_BUF];
+    for (size_t i = 0; i < TICK_BUF; ++i)
+        freqs[i] = 440.0 + 20.0 * sin(TWOPI * i / TICK_BUF);
+    OSCILT *single = new_oscilt(44100, gtable, 0.0);
+    OSCILT *block = new_oscilt(44100, gtable, 0.0);
+    OSCILT *fm = new_oscilt(44100, gtable, 0.0);
+    if (single == NULL || block == NULL || fm == NULL)
+    {
+        printf("No memory\n");
+        goto cleanup;
+    }
+
+    printf("\nInterpolating tick, %d frames\n", TICK_FRAMES);
+    printf("%10s %12s %12s %12s\n", "", "per sample", "block", "block fm");
+    clock_t start = clock();
+    for (size_t i = 0; i < TICK_FRAMES; i += TICK_BUF)
+        for (size_t j = 0; j < TICK_BUF; ++j)
+            out[j] = (float)tabtick_interp(single, 440.0);
+    double single_ms = elapsed_ms(start);
+    start = clock();
+    for (size_t i = 0; i < TICK_FRAMES; i += TICK_BUF)
+        tabtick_interp_block(block, 440.0, out, TICK_BUF);
+    double block_ms = elapsed_ms(start);
+    start = clock();
+    for (size_t i = 0; i < TICK_FRAMES; i += TICK_BUF)
+        tabtick_interp_block_fm(fm, freqs, out, TICK_BUF);
+    double fm_ms = elapsed_ms(start);
+    printf("%10s %12.3f %12.3f %12.3f\n", "ms", single_ms, block_ms, fm_ms);
+
+cleanup:
+    free(single);
+    free(block);
+    free(fm);
+}
+
+/*
+ * Time block ticks over double and float tables of 512 to 65536 points. At
+ * 440 Hz a cycle sweeps the whole table, so once the double table outgrows a
+ * cache level the float table of the same length still fits in it.
+ */
+static void bench_table_types(void)
+{
+    static float out[TICK_BUF];
+    printf("\nBlock ticks by table type, ns/sample, %d frames\n",
+           TICK_FRAMES);
+    printf("%10s %10s %10s %12s %12s %12s\n", "length", "double KB",
+           "float KB", "double lin", "float lin", "float cubic");
+    for (size_t length = 512; length <= 65536; length *= 2)
+    {
+        GTABLE *gtable = new_saw(length, 40, SAW_DOWN);
+        GTABLEF *gtablef = new_gtablef(gtable);
+        OSCILT *oscs[3] = {new_oscilt(44100, gtable, 0.0),
+                           new_oscilt_float(44100, gtablef, 0.0),
+                           new_oscilt_float(44100, gtablef, 0.0)};
+        oscilt_blockfunc ticks[3] = {tabtick_interp_block,
+                                     tabtick_interp_block, tabtick_cubic_block};
+        double ns[3] = {0.0, 0.0, 0.0};
+        bool ok = oscs[0] && oscs[1] && oscs[2];
+        for (int k = 0; ok && k < 3; ++k)
+        {
+            clock_t start = clock();
+            for (size_t i = 0; i < TICK_FRAMES; i += TICK_BUF)
+                ticks[k](oscs[k], 440.0, out, TICK_BUF);
+            ns[k] = elapsed_ms(start) * 1e6 / TICK_FRAMES;
+        }
+        for (int k = 0; k < 3; ++k)
+            free(oscs[k]);
+        gtable_free(&gtable);
+        gtablef_free(&gtablef);
+        if (!ok)
+        {
+            printf("No memory\n");
+            return;
+        }
+        printf("%10zu %10zu %10zu %12.3f %12.3f %12.3f\n", length,
+               (length + 1) * sizeof(double) / 1024,
+               (length + 2 * GTABLEF_GUARDS) * sizeof(float) / 1024, ns[0],
+               ns[1], ns[2]);
+    }
+}
+
+int main(void)
+{
+    printf("Saw table generation, nharmonics = length / 2 - 1\n");
+    printf("%10s %12s %12s %12s\n", "length", "direct ms", "fft ms",
+           "cached ms");
+    for (size_t length = 512; length <= 32768; length *= 2)
+    {
+        size_t nharmonics = length / 2 - 1;
+
+        clock_t start = clock();
+        GTABLE *direct = new_saw_direct(length, nharmonics);
+        double direct_ms = elapsed_ms(start);
+
+        tabcache_enable(false);
+        start = clock();
+        GTABLE *spectral = new_saw(length, nharmonics, SAW_DOWN);
+        double fft_ms = elapsed_ms(start);
+
+        // Store the table in the cache, then time mapping it back
+        tabcache_enable(true);
+        GTABLE *stored = new_saw(length, nharmonics, SAW_DOWN);
+        start = clock();
+        GTABLE *cached = new_saw(length, nharmonics, SAW_DOWN);
+        double cached_ms = elapsed_ms(start);
+
+        if (direct == NULL || spectral == NULL || stored == NULL ||
+            cached == NULL)
+        {
+            printf("No memory\n");
+            gtable_free(&direct);
+            gtable_free(&spectral);
+            gtable_free(&stored);
+            gtable_free(&cached);
+            return EXIT_FAILURE;
+        }
+        printf("%10zu %12.3f %12.3f %12.3f%s\n", length, direct_ms, fft_ms,
+               cached_ms, cached->mapped_size ? "" : " (cache unavailable)");
+        gtable_free(&direct);
+        gtable_free(&spectral);
+        gtable_free(&stored);
+        gtable_free(&cached);
+    }
+
+    GTABLE *saw = new_saw(1024, 40, SAW_DOWN);
+    if (saw == NULL)
+    {
+        printf("No memory\n");
+        return EXIT_FAILURE;
+    }
+    bench_ticks(saw);
+    gtable_free(&saw);
+    bench_table_types();
+    return EXIT_SUCCESS;
+}
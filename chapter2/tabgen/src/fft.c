@@ -0,0 +1,50 @@
+#include "fft.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI (3.1415926535897932)
+#endif
+
+bool is_power_of_two(size_t n) { return n > 0 && (n & (n - 1)) == 0; }
+
+/*
+ * In-place iterative radix-2 FFT. n must be a power of two. The inverse
+ * transform is not scaled by 1/n.
+ */
+void fft(double complex *x, size_t n, bool inverse)
+{
+    // Bit reversal permutation
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            double complex tmp = x[i];
+            x[i] = x[j];
+            x[j] = tmp;
+        }
+    }
+
+    // Butterflies. Twiddles are computed directly rather than by repeated
+    // multiplication to keep the error independent of the transform size.
+    const double sign = inverse ? 1.0 : -1.0;
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        const size_t half = len / 2;
+        for (size_t j = 0; j < half; ++j)
+        {
+            double angle = sign * 2.0 * M_PI * (double)j / (double)len;
+            double complex w = cos(angle) + I * sin(angle);
+            for (size_t i = 0; i < n; i += len)
+            {
+                double complex u = x[i + j];
+                double complex v = x[i + j + half] * w;
+                x[i + j] = u + v;
+                x[i + j + half] = u - v;
+            }
+        }
+    }
+}
@@ -1,6 +1,12 @@
+#define _POSIX_C_SOURCE 200809L // posix_memalign
 #include "gtable.h"
+#include "fft.h"
+#include "tabcache.h"
 #include <stdbool.h>
 
+// Bump when table generation changes, so that stale cached tables are rebuilt
+#define TABLE_GENERATOR 1
+
 // Create new gtable filled with zeroes
 GTABLE *new_gtable(size_t length)
 {
@@ -16,30 +22,65 @@ GTABLE *new_gtable(size_t length)
         return NULL;
     }
     gtable->length = length;
+    gtable->mapped_size = 0;
     return gtable;
 }
 
-// Create new gtable filled with a sine wave
-GTABLE *new_sine(size_t length)
+static TABCACHE_KEY table_key(unsigned waveform, size_t nharmonics,
+                              size_t length)
 {
-    if (length == 0)
+    // One guard point, double samples
+    TABCACHE_KEY key = {"tabgen", TABLE_GENERATOR, waveform,
+                        (uint32_t)nharmonics, (uint32_t)length, 1,
+                        TABCACHE_FLOAT64};
+    return key;
+}
+
+// Table of key mapped from the cache, or NULL if it is not cached
+static GTABLE *load_cached(const TABCACHE_KEY *key)
+{
+    size_t mapped_size = 0;
+    const void *samples = tabcache_load(key, &mapped_size);
+    if (samples == NULL)
         return NULL;
     GTABLE *gtable = malloc(sizeof(GTABLE));
     if (gtable == NULL)
-        return NULL;
-    gtable->table = malloc((length + 1) * sizeof(double));
-    if (gtable->table == NULL)
     {
-        free(gtable);
+        tabcache_release(samples, mapped_size);
         return NULL;
     }
-    gtable->length = length;
+    gtable->table = (double *)samples; // Read-only, never written
+    gtable->length = key->length;
+    gtable->mapped_size = mapped_size;
+    return gtable;
+}
+
+// Store generated gtable (if any) in the cache and return it
+static GTABLE *store_cached(const TABCACHE_KEY *key, GTABLE *gtable)
+{
+    if (gtable)
+        tabcache_store(key, gtable->table);
+    return gtable;
+}
+
+// Create new gtable filled with a sine wave
+GTABLE *new_sine(size_t length)
+{
+    if (length == 0)
+        return NULL;
+    TABCACHE_KEY key = table_key(GTABLE_SINE, 0, length);
+    GTABLE *gtable = load_cached(&key);
+    if (gtable)
+        return gtable;
+    gtable = new_gtable(length);
+    if (gtable == NULL)
+        return NULL;
     double step = TWOPI / length;
     // Fill table with one cycle of a sine wave
     for (size_t i = 0; i < length; ++i)
         gtable->table[i] = sin(step * i);
     gtable->table[length] = gtable->table[0]; // guard point
-    return gtable;
+    return store_cached(&key, gtable);
 }
 
 // Destructor for GTABLE object
@@ -47,12 +88,56 @@ void gtable_free(GTABLE **gtable)
 {
     if (gtable && *gtable && (*gtable)->table)
     {
-        free((*gtable)->table);
+        if ((*gtable)->mapped_size)
+            tabcache_release((*gtable)->table, (*gtable)->mapped_size);
+        else
+            free((*gtable)->table);
         free(*gtable);
         *gtable = NULL;
     }
 }
 
+// Float copy of gtable with guard points on both ends
+GTABLEF *new_gtablef(const GTABLE *gtable)
+{
+    if (gtable == NULL || gtable->table == NULL ||
+        gtable->length < GTABLEF_GUARDS)
+        return NULL;
+    GTABLEF *gtablef = malloc(sizeof(GTABLEF));
+    if (gtablef == NULL)
+        return NULL;
+    // Leading guard points sit in the padding before the aligned cycle
+    const size_t lead = GTABLEF_ALIGN / sizeof(float);
+    const size_t length = gtable->length;
+    if (posix_memalign(&gtablef->block, GTABLEF_ALIGN,
+                       (lead + length + GTABLEF_GUARDS) * sizeof(float)))
+    {
+        free(gtablef);
+        return NULL;
+    }
+    float *table = (float *)gtablef->block + lead;
+    for (size_t i = 0; i < length; ++i)
+        table[i] = (float)gtable->table[i];
+    for (size_t i = 1; i <= GTABLEF_GUARDS; ++i)
+        table[-(ptrdiff_t)i] = table[length - i];
+    for (size_t i = 0; i < GTABLEF_GUARDS; ++i)
+        table[length + i] = table[i];
+    gtablef->table = table;
+    gtablef->length = length;
+    return gtablef;
+}
+
+// Destructor for GTABLEF object
+void gtablef_free(GTABLEF **gtablef)
+{
+    if (gtablef && *gtablef)
+    {
+        free((*gtablef)->block);
+        free(*gtablef);
+        *gtablef = NULL;
+    }
+}
+
 static void normalize_gtable(GTABLE *gtable)
 {
     double max_amp = 0.0;
@@ -70,44 +155,106 @@ static void normalize_gtable(GTABLE *gtable)
     gtable->table[gtable->length] = gtable->table[0];
 }
 
-// Create lookup table filled with triangle wave
-GTABLE *new_triangle(size_t length, unsigned nharmonics)
+/*
+ * Create lookup table from a harmonic spectrum. amps[k] and phases[k] are the
+ * amplitude and cosine phase (in radians) of harmonic k + 1, phases may be
+ * NULL for all zero phases. Power of two lengths are synthesized with an
+ * inverse FFT in O(length log length), others by direct summation. The
+ * resulting table is normalized.
+ */
+GTABLE *new_gtable_spectrum(size_t length, const double *amps,
+                            const double *phases, size_t nharmonics)
 {
-    if (length == 0 || nharmonics == 0 || nharmonics >= length / 2)
+    if (length == 0 || amps == NULL || nharmonics == 0)
         return NULL;
     GTABLE *gtable = new_gtable(length);
-    // Generate triangle wave
-    size_t harmonic = 1;
-    const double step = TWOPI / length;
-    for (unsigned i = 0; i < nharmonics; ++i)
+    if (gtable == NULL)
+        return NULL;
+
+    if (is_power_of_two(length))
+    {
+        double complex *bins = calloc(length, sizeof(double complex));
+        if (bins == NULL)
+        {
+            gtable_free(&gtable);
+            return NULL;
+        }
+        // Harmonics at or above length fold back like they would when summed
+        for (size_t k = 0; k < nharmonics; ++k)
+        {
+            double phase = phases ? phases[k] : 0.0;
+            bins[(k + 1) % length] += amps[k] * (cos(phase) + I * sin(phase));
+        }
+        fft(bins, length, true);
+        for (size_t j = 0; j < length; ++j)
+            gtable->table[j] = creal(bins[j]);
+        free(bins);
+    }
+    else
     {
-        double amplitude = 1.0 / (harmonic * harmonic);
-        for (size_t j = 0; j < gtable->length; ++j)
-            gtable->table[j] += amplitude * cos(j * step * harmonic);
-        harmonic += 2; // triangle contains only odd harmonics
+        const double step = TWOPI / length;
+        for (size_t k = 0; k < nharmonics; ++k)
+        {
+            double phase = phases ? phases[k] : 0.0;
+            for (size_t j = 0; j < length; ++j)
+                gtable->table[j] += amps[k] * cos(j * step * (k + 1) + phase);
+        }
     }
     normalize_gtable(gtable);
     return gtable;
 }
 
+/*
+ * Create lookup table of nharmonics partials, every step:th harmonic, with
+ * amplitude scale / harmonic^power and cosine phase phase
+ */
+static GTABLE *new_harmonic_series(size_t length, size_t nharmonics,
+                                   size_t step, double scale, double power,
+                                   double phase)
+{
+    size_t highest = 1 + (nharmonics - 1) * step;
+    double *amps = calloc(highest, sizeof(double));
+    double *phases = malloc(highest * sizeof(double));
+    GTABLE *gtable = NULL;
+    if (amps && phases)
+    {
+        for (size_t harmonic = 1; harmonic <= highest; harmonic += step)
+            amps[harmonic - 1] = scale / pow((double)harmonic, power);
+        for (size_t i = 0; i < highest; ++i)
+            phases[i] = phase;
+        gtable = new_gtable_spectrum(length, amps, phases, highest);
+    }
+    free(amps);
+    free(phases);
+    return gtable;
+}
+
+// Create lookup table filled with triangle wave
+GTABLE *new_triangle(size_t length, unsigned nharmonics)
+{
+    if (length == 0 || nharmonics == 0 || nharmonics >= length / 2)
+        return NULL;
+    TABCACHE_KEY key = table_key(GTABLE_TRIANGLE, nharmonics, length);
+    GTABLE *gtable = load_cached(&key);
+    if (gtable)
+        return gtable;
+    // Triangle contains only odd harmonics, cosine phase
+    return store_cached(
+        &key, new_harmonic_series(length, nharmonics, 2, 1.0, 2.0, 0.0));
+}
+
 // Create lookup table filled with square wave
 GTABLE *new_square(size_t length, unsigned nharmonics)
 {
     if (length == 0 || nharmonics == 0 || nharmonics >= length / 2)
         return NULL;
-    GTABLE *gtable = new_gtable(length);
-    // Generate square wave
-    size_t harmonic = 1;
-    const double step = TWOPI / length;
-    for (size_t i = 0; i < nharmonics; ++i)
-    {
-        double amplitude = 1.0 / harmonic;
-        for (size_t j = 0; j < gtable->length; ++j)
-            gtable->table[j] += amplitude * sin(j * step * harmonic);
-        harmonic += 2; // square wave contains only odd harmonics
-    }
-    normalize_gtable(gtable);
-    return gtable;
+    TABCACHE_KEY key = table_key(GTABLE_SQUARE, nharmonics, length);
+    GTABLE *gtable = load_cached(&key);
+    if (gtable)
+        return gtable;
+    // Square wave contains only odd harmonics, sine phase
+    return store_cached(
+        &key, new_harmonic_series(length, nharmonics, 2, 1.0, 1.0, -M_PI / 2));
 }
 
 // Create lookup table filled with saw wave, direction defined with up parmeter
@@ -115,22 +262,17 @@ GTABLE *new_saw(size_t length, size_t nharmonics, SAW_DIRECTION direction)
 {
     if (length == 0 || nharmonics == 0 || nharmonics >= length / 2)
         return NULL;
-    GTABLE *gtable = new_gtable(length);
-    // Generate square wave
-    size_t harmonic = 1;
-    const double step = TWOPI / length;
+    unsigned waveform = direction == SAW_UP ? GTABLE_SAW_UP : GTABLE_SAW_DOWN;
+    TABCACHE_KEY key = table_key(waveform, nharmonics, length);
+    GTABLE *gtable = load_cached(&key);
+    if (gtable)
+        return gtable;
     double amplitude = 1.0;
     if (direction == SAW_UP)
         amplitude = -1.0;
-    for (size_t i = 0; i < nharmonics; ++i)
-    {
-        double value = amplitude / harmonic;
-        for (size_t j = 0; j < gtable->length; ++j)
-            gtable->table[j] += value * sin(j * step * harmonic);
-        ++harmonic;
-    }
-    normalize_gtable(gtable);
-    return gtable;
+    // Saw contains all harmonics, sine phase
+    return store_cached(&key, new_harmonic_series(length, nharmonics, 1,
+                                                  amplitude, 1.0, -M_PI / 2));
 }
 
 // Constructor for OSCILT
@@ -148,11 +290,43 @@ OSCILT *new_oscilt(double srate, const GTABLE *gtable, double phase)
     p_osc->osc.current_phase = gtable->length * phase;
     p_osc->osc.phase_increment = 0.0;
     p_osc->gtable = gtable;
+    p_osc->gtablef = NULL;
     p_osc->dtablen = (double)gtable->length;
     p_osc->size_over_srate = p_osc->dtablen / (double)srate;
     return p_osc;
 }
 
+// Constructor for OSCILT reading a float table
+OSCILT *new_oscilt_float(double srate, const GTABLEF *gtablef, double phase)
+{
+    if (gtablef == NULL || gtablef->table == NULL || gtablef->length == 0)
+        return NULL;
+    OSCILT *p_osc = malloc(sizeof(OSCILT));
+    if (p_osc == NULL)
+        return NULL;
+
+    p_osc->osc.current_freq = 0.0;
+    p_osc->osc.current_phase = gtablef->length * phase;
+    p_osc->osc.phase_increment = 0.0;
+    p_osc->gtable = NULL;
+    p_osc->gtablef = gtablef;
+    p_osc->dtablen = (double)gtablef->length;
+    p_osc->size_over_srate = p_osc->dtablen / (double)srate;
+    return p_osc;
+}
+
+// 4-point, 3rd-order Lagrange interpolation between y1 and y2
+static inline float cubic_interpolate(float y0, float y1, float y2, float y3,
+                                      float fraction)
+{
+    float tmp = y3 + 3.f * y1;
+    float fraction_squared = fraction * fraction;
+    float fraction_cubed = fraction * fraction_squared;
+    return fraction_cubed * (-y0 - 3.f * y2 + tmp) / 6.f +
+           fraction_squared * ((y0 + y2) / 2.f - y1) +
+           fraction * (y2 + (-2.f * y0 - tmp) / 6.f) + y1;
+}
+
 // Truncating tick function for table lookup oscillator
 double tabtick_trunc(OSCILT *p_osc, double freq)
 {
@@ -204,4 +378,215 @@ double tabtick_interp(OSCILT *p_osc, double freq)
         current_phase += dtablen;
     p_osc->osc.current_phase = current_phase;
     return value;
-}
\ No newline at end of file
+}
+
+// Cubic interpolating tick function for table lookup oscillator of a float
+// table. The guard points make the four point lookup branch free.
+double tabtick_cubic(OSCILT *p_osc, double freq)
+{
+    int index = (int)p_osc->osc.current_phase;
+    double dtablen = p_osc->dtablen, current_phase = p_osc->osc.current_phase;
+    const float *table = p_osc->gtablef->table;
+    // Update oscillator's internal frequency to match
+    if (p_osc->osc.current_freq != freq)
+    {
+        p_osc->osc.current_freq = freq;
+        p_osc->osc.phase_increment =
+            p_osc->size_over_srate * p_osc->osc.current_freq;
+    }
+
+    double value =
+        cubic_interpolate(table[index - 1], table[index], table[index + 1],
+                          table[index + 2], (float)(current_phase - index));
+
+    // Advance oscillator phase
+    current_phase += p_osc->osc.phase_increment;
+    while (current_phase >= dtablen)
+        current_phase -= dtablen;
+    while (current_phase < 0.0)
+        current_phase += dtablen;
+    p_osc->osc.current_phase = current_phase;
+    return value;
+}
+#define TICK_CHUNK 256 // Samples per phase buffer of the block ticks
+
+/*
+ * Write the phases of the next n (at most TICK_CHUNK) samples to phases and
+ * advance the oscillator past them. The frequency is freqs[i] for sample i,
+ * or the current frequency if freqs is NULL. Unlike the single sample ticks,
+ * which wrap after every increment, the unwrapped phases are summed first
+ * and wrapped afterwards in a loop without carried dependencies, so that it
+ * vectorizes. The phases agree with the ticks up to rounding.
+ */
+static void block_phases(OSCILT *p_osc, const double *freqs, double *phases,
+                         size_t n)
+{
+    double dtablen = p_osc->dtablen, inv_tablen = 1.0 / dtablen;
+    double current_phase = p_osc->osc.current_phase;
+    if (freqs)
+    {
+        double increments[TICK_CHUNK];
+        for (size_t i = 0; i < n; ++i)
+            increments[i] = p_osc->size_over_srate * freqs[i];
+        for (size_t i = 0; i < n; ++i)
+        {
+            phases[i] = current_phase;
+            current_phase += increments[i];
+        }
+        // Later single sample ticks continue from the last frequency
+        p_osc->osc.current_freq = freqs[n - 1];
+        p_osc->osc.phase_increment = increments[n - 1];
+    }
+    else
+    {
+        double increment = p_osc->osc.phase_increment;
+        for (size_t i = 0; i < n; ++i)
+            phases[i] = current_phase + (int)i * increment;
+        current_phase += (double)n * increment;
+    }
+
+    // Truncation equals floor for non-negative phases, the rest is fixed up
+    for (size_t i = 0; i < n; ++i)
+    {
+        double phase = phases[i];
+        phase -= (int)(phase * inv_tablen) * dtablen;
+        phase += (phase < 0.0) * dtablen;
+        phases[i] = phase - (phase >= dtablen) * dtablen;
+    }
+    current_phase -= floor(current_phase * inv_tablen) * dtablen;
+    p_osc->osc.current_phase = current_phase < dtablen ? current_phase : 0.0;
+}
+
+typedef enum tick_lookup
+{
+    LOOKUP_TRUNC,
+    LOOKUP_INTERP,
+    LOOKUP_CUBIC
+} TICK_LOOKUP;
+
+static void trunc_phases(const double *table, const double *phases,
+                         float *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = (float)table[(int)phases[i]];
+}
+
+static void interp_phases(const double *table, const double *phases,
+                          float *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        int base_index = (int)phases[i];
+        double value = table[base_index];
+        double slope = table[base_index + 1] - value;
+        out[i] = (float)(value + (phases[i] - base_index) * slope);
+    }
+}
+
+static void trunc_phasesf(const float *table, const double *phases,
+                          float *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = table[(int)phases[i]];
+}
+
+static void interp_phasesf(const float *table, const double *phases,
+                           float *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        int base_index = (int)phases[i];
+        float fraction = (float)(phases[i] - base_index);
+        float value = table[base_index];
+        out[i] = value + fraction * (table[base_index + 1] - value);
+    }
+}
+
+static void cubic_phasesf(const float *table, const double *phases,
+                          float *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        int index = (int)phases[i];
+        out[i] = cubic_interpolate(table[index - 1], table[index],
+                                   table[index + 1], table[index + 2],
+                                   (float)(phases[i] - index));
+    }
+}
+
+static void tabtick_block(OSCILT *p_osc, const double *freqs, float *out,
+                          size_t n, TICK_LOOKUP lookup)
+{
+    double phases[TICK_CHUNK];
+    for (size_t done = 0; done < n; done += TICK_CHUNK)
+    {
+        size_t count = n - done < TICK_CHUNK ? n - done : TICK_CHUNK;
+        block_phases(p_osc, freqs ? freqs + done : NULL, phases, count);
+        if (p_osc->gtablef)
+        {
+            const float *table = p_osc->gtablef->table;
+            if (lookup == LOOKUP_CUBIC)
+                cubic_phasesf(table, phases, out + done, count);
+            else if (lookup == LOOKUP_INTERP)
+                interp_phasesf(table, phases, out + done, count);
+            else
+                trunc_phasesf(table, phases, out + done, count);
+        }
+        else if (lookup == LOOKUP_INTERP)
+            interp_phases(p_osc->gtable->table, phases, out + done, count);
+        else
+            trunc_phases(p_osc->gtable->table, phases, out + done, count);
+    }
+}
+
+static void set_frequency(OSCILT *p_osc, double freq)
+{
+    if (p_osc->osc.current_freq != freq)
+    {
+        p_osc->osc.current_freq = freq;
+        p_osc->osc.phase_increment =
+            p_osc->size_over_srate * p_osc->osc.current_freq;
+    }
+}
+
+// Fill out with n samples of tabtick_trunc at frequency freq
+void tabtick_trunc_block(OSCILT *p_osc, double freq, float *out, size_t n)
+{
+    set_frequency(p_osc, freq);
+    tabtick_block(p_osc, NULL, out, n, LOOKUP_TRUNC);
+}
+
+// Fill out with n samples of tabtick_interp at frequency freq
+void tabtick_interp_block(OSCILT *p_osc, double freq, float *out, size_t n)
+{
+    set_frequency(p_osc, freq);
+    tabtick_block(p_osc, NULL, out, n, LOOKUP_INTERP);
+}
+
+// Fill out with n samples of tabtick_trunc, at frequency freqs[i] for sample i
+void tabtick_trunc_block_fm(OSCILT *p_osc, const double *freqs, float *out,
+                            size_t n)
+{
+    tabtick_block(p_osc, freqs, out, n, LOOKUP_TRUNC);
+}
+
+// Fill out with n samples of tabtick_interp, at frequency freqs[i] for sample i
+void tabtick_interp_block_fm(OSCILT *p_osc, const double *freqs, float *out,
+                             size_t n)
+{
+    tabtick_block(p_osc, freqs, out, n, LOOKUP_INTERP);
+}
+
+// Fill out with n samples of tabtick_cubic at frequency freq
+void tabtick_cubic_block(OSCILT *p_osc, double freq, float *out, size_t n)
+{
+    set_frequency(p_osc, freq);
+    tabtick_block(p_osc, NULL, out, n, LOOKUP_CUBIC);
+}
+
+// Fill out with n samples of tabtick_cubic, at frequency freqs[i] for sample i
+void tabtick_cubic_block_fm(OSCILT *p_osc, const double *freqs, float *out,
+                            size_t n)
+{
+    tabtick_block(p_osc, freqs, out, n, LOOKUP_CUBIC);
+}
@@ -0,0 +1,98 @@
+#include "gtable_registry.h"
+#include <pthread.h>
+
+typedef struct registry_entry
+{
+    GTABLE_WAVEFORM waveform;
+    size_t length;
+    unsigned nharmonics;
+    GTABLE *gtable;
+    size_t refcount;
+    struct registry_entry *next;
+} REGISTRY_ENTRY;
+
+// Held during lookups, generation and reference count updates
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static REGISTRY_ENTRY *registry = NULL;
+
+static GTABLE *generate(GTABLE_WAVEFORM waveform, size_t length,
+                        unsigned nharmonics)
+{
+    switch (waveform)
+    {
+    case GTABLE_SINE:
+        return new_sine(length);
+    case GTABLE_TRIANGLE:
+        return new_triangle(length, nharmonics);
+    case GTABLE_SQUARE:
+        return new_square(length, nharmonics);
+    case GTABLE_SAW_DOWN:
+        return new_saw(length, nharmonics, SAW_DOWN);
+    case GTABLE_SAW_UP:
+        return new_saw(length, nharmonics, SAW_UP);
+    default:
+        return NULL;
+    }
+}
+
+const GTABLE *gtable_acquire(GTABLE_WAVEFORM waveform, size_t length,
+                             unsigned nharmonics)
+{
+    if (waveform == GTABLE_SINE)
+        nharmonics = 0; // All sines of a length are the same table
+    const GTABLE *gtable = NULL;
+    pthread_mutex_lock(&registry_lock);
+    for (REGISTRY_ENTRY *entry = registry; entry; entry = entry->next)
+    {
+        if (entry->waveform == waveform && entry->length == length &&
+            entry->nharmonics == nharmonics)
+        {
+            entry->refcount++;
+            gtable = entry->gtable;
+            goto unlock;
+        }
+    }
+
+    // Generate while holding the lock, so a table is never made twice
+    REGISTRY_ENTRY *entry = malloc(sizeof(REGISTRY_ENTRY));
+    if (entry == NULL)
+        goto unlock;
+    entry->gtable = generate(waveform, length, nharmonics);
+    if (entry->gtable == NULL)
+    {
+        free(entry);
+        goto unlock;
+    }
+    entry->waveform = waveform;
+    entry->length = length;
+    entry->nharmonics = nharmonics;
+    entry->refcount = 1;
+    entry->next = registry;
+    registry = entry;
+    gtable = entry->gtable;
+
+unlock:
+    pthread_mutex_unlock(&registry_lock);
+    return gtable;
+}
+
+void gtable_release(const GTABLE *gtable)
+{
+    if (gtable == NULL)
+        return;
+    pthread_mutex_lock(&registry_lock);
+    for (REGISTRY_ENTRY **link = &registry; *link; link = &(*link)->next)
+    {
+        REGISTRY_ENTRY *entry = *link;
+        if (entry->gtable != gtable)
+            continue;
+        if (--entry->refcount == 0)
+        {
+            *link = entry->next;
+            gtable_free(&entry->gtable);
+            free(entry);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
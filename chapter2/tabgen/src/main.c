@@ -1,12 +1,13 @@
+#define _POSIX_C_SOURCE 199309L // clock_gettime
 #include "breakpoints.h"
 #include "gtable.h"
+#include "gtable_registry.h"
 #include "macros.h"
 #include "wave.h"
 #include <time.h>
 
 #define NFRAMES 1024u
 #define LOOKUP_TABLE_LENGTH 1024lu  // May be changed to vary quality of output
-#define TRUNCATING_TICK false       // Use interpolating tick if false
 
 enum
 {
@@ -32,27 +33,96 @@ enum
     WAVE_NWAVEFORMS
 };
 
+enum
+{
+    LOOKUP_TRUNCATE,
+    LOOKUP_LINEAR,
+    LOOKUP_CUBIC,
+    LOOKUP_NMODES
+};
+
+static double seconds_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*
+ * Write outframes frames of osc at frequency and amplitude to ofd, one
+ * buffer of NFRAMES at a time. tick_block synthesizes one channel of each
+ * buffer, which is then copied to every channel. Returns 0 on success.
+ */
+static int render(int ofd, OSCILT *osc, oscilt_blockfunc tick_block,
+                  double frequency, double amplitude, unsigned chans,
+                  size_t outframes, float *monoframe, float *outframe)
+{
+    for (size_t done = 0; done < outframes; done += NFRAMES)
+    {
+        unsigned nframes =
+            outframes - done < NFRAMES ? (unsigned)(outframes - done) : NFRAMES;
+        tick_block(osc, frequency, monoframe, nframes);
+        for (unsigned j = 0, k = 0; j < nframes; ++j)
+        {
+            float val = (float)(amplitude * monoframe[j]);
+            for (unsigned chan = 0; chan < chans; chan++)
+                outframe[k++] = val;
+        }
+        if (psf_sndWriteFloatFrames(ofd, outframe, nframes) != (int)nframes)
+            return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char const *argv[])
 {
     int error = 0;
     int ofd = -1;
-    float *outframe = NULL;
+    float *outframe = NULL, *monoframe = NULL;
     OSCILT *osc = NULL;
+    const GTABLE *gtable = NULL;
+    GTABLEF *gtablef = NULL;
+    int lookup = LOOKUP_LINEAR;
     PSF_PROPS outprops;
 
     printf("tabgen - generate tones with table lookup oscillator\n");
 
     // Handle commandline arguments
+    while (argc > 1 && argv[1][0] == '-')
+    {
+        char flag = argv[1][1];
+        switch (flag)
+        {
+        case 'l':
+            lookup = (int)strtol(&argv[1][2], NULL, 10);
+            if (lookup < 0 || lookup >= LOOKUP_NMODES)
+            {
+                printf("Error: invalid lookup mode: %d\n", lookup);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        default:
+            break;
+        }
+        argc--;
+        argv++;
+    }
+
     if (argc < ARG_NARGS)
     {
         printf("Error: insufficient number of arguments\n");
-        printf("Usage: tabgen outfile duration srate nchannels amplitude freq "
-               "waveform nharmonics\nAvailable waveforms:\n"
+        printf("Usage: tabgen [-lN] outfile duration srate nchannels amplitude "
+               "freq waveform nharmonics\nAvailable waveforms:\n"
                "       0 - square\n"
                "       1 - triangle\n"
                "       2 - saw (down)\n"
                "       3 - saw (up)\n"
-               "       4 - sine\n");
+               "       4 - sine\n"
+               "Lookup modes (-lN):\n"
+               "       0 - truncate\n"
+               "       1 - linear interpolation (default)\n"
+               "       2 - cubic interpolation\n");
         return EXIT_FAILURE;
     }
 
@@ -125,28 +195,21 @@ int main(int argc, char const *argv[])
         goto cleanup;
     }
 
-    // Initialize lookup table according to waveform
-    GTABLE *gtable = NULL;
-    switch (waveform)
+    // Lookup table of waveform, shared through the table registry
+    static const GTABLE_WAVEFORM table_waveforms[WAVE_NWAVEFORMS] = {
+        GTABLE_SQUARE, GTABLE_TRIANGLE, GTABLE_SAW_DOWN, GTABLE_SAW_UP,
+        GTABLE_SINE};
+    gtable = gtable_acquire(table_waveforms[waveform], LOOKUP_TABLE_LENGTH,
+                            nharmonics);
+
+    // Cubic lookup reads a float copy of the table with guard points
+    if (lookup == LOOKUP_CUBIC)
     {
-    case WAVE_SQUARE:
-        gtable = new_square(LOOKUP_TABLE_LENGTH, nharmonics);
-        break;
-    case WAVE_TRIANGLE:
-        gtable = new_triangle(LOOKUP_TABLE_LENGTH, nharmonics);
-        break;
-    case WAVE_SAW_UP:
-        gtable = new_saw(LOOKUP_TABLE_LENGTH, nharmonics, SAW_UP);
-        break;
-    case WAVE_SAW_DOWN:
-        gtable = new_saw(LOOKUP_TABLE_LENGTH, nharmonics, SAW_DOWN);
-        break;
-    case WAVE_SINE:
-        gtable = new_sine(LOOKUP_TABLE_LENGTH);
-        break;
+        gtablef = new_gtablef(gtable);
+        osc = new_oscilt_float(outprops.srate, gtablef, 0.0);
     }
-
-    osc = new_oscilt(outprops.srate, gtable, 0.0);
+    else
+        osc = new_oscilt(outprops.srate, gtable, 0.0);
     if (osc == NULL)
     {
         printf(
@@ -159,48 +222,30 @@ int main(int argc, char const *argv[])
     outframe =
         malloc((unsigned long)outprops.chans * NFRAMES * sizeof(float));
     ON_MALLOC_ERROR(outframe);
+    monoframe = malloc(NFRAMES * sizeof(float));
+    ON_MALLOC_ERROR(monoframe);
 
+    // Select the block tick of the lookup mode once for the whole render
+    oscilt_blockfunc tick_blocks[LOOKUP_NMODES] = {
+        tabtick_trunc_block, tabtick_interp_block, tabtick_cubic_block};
     size_t outframes =
-        (size_t)(duration * outprops.srate + 0.5);  // Number of output frames
-    size_t nbufs = outframes / (NFRAMES);           // Number of buffers to fill
-    size_t remainder = outframes - nbufs * NFRAMES; // Count of remaining frames
-    if (remainder > 0)
-        ++nbufs;
+        (size_t)(duration * outprops.srate + 0.5); // Number of output frames
 
     // Generate sound
-    unsigned nframes =
-        (unsigned)outprops.chans * NFRAMES; // Number of frames in buffer
-    time_t starttime = clock();
-    for (size_t i = 0; i < nbufs; i++)
+    double start = seconds_now();
+    if (render(ofd, osc, tick_blocks[lookup], frequency, amplitude,
+               (unsigned)outprops.chans, outframes, monoframe, outframe))
     {
-        if (i == nbufs - 1) // Make only remainder amount of samples on last run
-            nframes = remainder;
-
-        for (unsigned k = 0; k < nframes; k += (unsigned)outprops.chans)
-        {
-            double val = 0.0;
-            if (TRUNCATING_TICK)
-                val = tabtick_trunc(osc, frequency);
-            else
-                val = tabtick_interp(osc, frequency);
-            for (unsigned chan = 0; chan < (unsigned)outprops.chans; chan++)
-            {
-                outframe[k + chan] = (float)(amplitude * val);
-            }
-        }
-
-        int written_frames = psf_sndWriteFloatFrames(
-            ofd, outframe, nframes / (unsigned)outprops.chans);
-        if (written_frames != (int)nframes / outprops.chans)
-        {
-            printf("Error writing to outfile\n");
-            error++;
-            goto cleanup;
-        }
+        printf("Error writing to outfile\n");
+        error++;
+        goto cleanup;
     }
-    time_t endtime = clock();
+    double elapsed = seconds_now() - start;
     printf("Successfully wrote %zu frames to %s in %.3f seconds\n", outframes,
-           argv[ARG_OUTFILE], (endtime - starttime) / (double)CLOCKS_PER_SEC);
+           argv[ARG_OUTFILE], elapsed);
+    if (elapsed > 0.0)
+        printf("%.0f frames/s, %.1fx realtime\n", outframes / elapsed,
+               duration / elapsed);
 
 cleanup:
     if (ofd > 0)
@@ -208,10 +253,12 @@ cleanup:
             printf("Error: failed to close file %s\n", argv[ARG_OUTFILE]);
     if (osc)
         free(osc);
-    if (gtable)
-        gtable_free(&gtable);
+    gtablef_free(&gtablef);
+    gtable_release(gtable);
     if (outframe)
         free(outframe);
+    if (monoframe)
+        free(monoframe);
     psf_finish();
     return error;
 }
@@ -0,0 +1,158 @@
+#define _POSIX_C_SOURCE 200809L
+#include "tabcache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PATH_SIZE 4096
+
+typedef struct tabcache_header
+{
+    char magic[4];
+    uint32_t version, generator, waveform, nharmonics, length, nguards,
+        samptype;
+} TABCACHE_HEADER; // 32 bytes, no padding
+
+#define HEADER_SIZE sizeof(TABCACHE_HEADER)
+
+static bool cache_enabled = true;
+
+void tabcache_enable(bool enable) { cache_enabled = enable; }
+
+static size_t sample_size(TABCACHE_SAMPTYPE samptype)
+{
+    return samptype == TABCACHE_FLOAT64 ? sizeof(double) : sizeof(float);
+}
+
+static TABCACHE_HEADER make_header(const TABCACHE_KEY *key)
+{
+    TABCACHE_HEADER header = {{'W', 'T', 'A', 'B'},
+                              TABCACHE_VERSION,
+                              key->generator,
+                              key->waveform,
+                              key->nharmonics,
+                              key->length,
+                              key->nguards,
+                              (uint32_t)key->samptype};
+    return header;
+}
+
+// Create directory path and its parents. Returns 0 on success.
+static int make_dirs(char *path)
+{
+    for (char *p = path + 1; *p; ++p)
+    {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        int failed = mkdir(path, 0777) && errno != EEXIST;
+        *p = '/';
+        if (failed)
+            return -1;
+    }
+    return mkdir(path, 0777) && errno != EEXIST ? -1 : 0;
+}
+
+// Write cache directory of program to dir. Returns 0 if the cache is usable.
+static int cache_dir(const char *program, char *dir, size_t size)
+{
+    const char *base = getenv("WAVETABLE_CACHE");
+    int n;
+    if (!cache_enabled || (base && base[0] == '\0'))
+        return -1;
+    if (base)
+        n = snprintf(dir, size, "%s/%s", base, program);
+    else if ((base = getenv("XDG_CACHE_HOME")) && base[0] != '\0')
+        n = snprintf(dir, size, "%s/audioprogramming/%s", base, program);
+    else if ((base = getenv("HOME")) && base[0] != '\0')
+        n = snprintf(dir, size, "%s/.cache/audioprogramming/%s", base, program);
+    else
+        return -1;
+    return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+static int cache_path(const TABCACHE_KEY *key, char *path, size_t size)
+{
+    char dir[PATH_SIZE];
+    if (cache_dir(key->program, dir, sizeof(dir)))
+        return -1;
+    int n = snprintf(path, size, "%s/%u-%u-%u-%u-%s.wtab", dir,
+                     (unsigned)key->waveform, (unsigned)key->nharmonics,
+                     (unsigned)key->length, (unsigned)key->nguards,
+                     key->samptype == TABCACHE_FLOAT64 ? "f64" : "f32");
+    return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+const void *tabcache_load(const TABCACHE_KEY *key, size_t *mapped_size)
+{
+    char path[PATH_SIZE];
+    if (cache_path(key, path, sizeof(path)))
+        return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    size_t expected = HEADER_SIZE + ((size_t)key->length + key->nguards) *
+                                        sample_size(key->samptype);
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == expected)
+        mapping = mmap(NULL, expected, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid
+    if (mapping == MAP_FAILED)
+        return NULL;
+
+    // A stale or foreign file is ignored, and replaced on the next store
+    TABCACHE_HEADER header = make_header(key);
+    if (memcmp(mapping, &header, sizeof(header)) != 0)
+    {
+        munmap(mapping, expected);
+        return NULL;
+    }
+    *mapped_size = expected;
+    return (const char *)mapping + HEADER_SIZE;
+}
+
+int tabcache_store(const TABCACHE_KEY *key, const void *samples)
+{
+    char path[PATH_SIZE], dir[PATH_SIZE], tmp_path[PATH_SIZE];
+    if (cache_path(key, path, sizeof(path)) ||
+        cache_dir(key->program, dir, sizeof(dir)) || make_dirs(dir))
+        return -1;
+    int n = snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path);
+    if (n < 0 || (size_t)n >= sizeof(tmp_path))
+        return -1;
+    int fd = mkstemp(tmp_path);
+    if (fd < 0)
+        return -1;
+
+    TABCACHE_HEADER header = make_header(key);
+    size_t data_size = ((size_t)key->length + key->nguards) *
+                       sample_size(key->samptype);
+    FILE *file = fdopen(fd, "wb");
+    int error = file == NULL;
+    if (!error)
+    {
+        error = fwrite(&header, sizeof(header), 1, file) != 1 ||
+                fwrite(samples, data_size, 1, file) != 1;
+        error |= fclose(file) != 0;
+    }
+    else
+        close(fd);
+    if (!error)
+        error = rename(tmp_path, path) != 0;
+    if (error)
+        unlink(tmp_path);
+    return error ? -1 : 0;
+}
+
+void tabcache_release(const void *samples, size_t mapped_size)
+{
+    if (samples)
+        munmap((char *)samples - HEADER_SIZE, mapped_size);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "oscillator.hpp"
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+/**
+ * Quality and cost of one lookup type at one table size
+ */
+struct AnalysisResult
+{
+    TableLookupType lookup;
+    std::size_t tableSize;
+    double snr;         // dB, sine against double precision sin()
+    double thd;         // dB relative to the fundamental, harmonics 2 to 10
+    double nsPerSample; // Block fill time
+};
+
+// Table sizes analyzed when none is given
+const std::vector<std::size_t> ANALYSIS_TABLE_SIZES = {256,  512,  1024,
+                                                       2048, 4096, 8192};
+
+const char *lookupName(TableLookupType lookup);
+
+/**
+ * Render a sine of frequency with every lookup type and every table size,
+ * and measure each against an ideal sine
+ */
+std::vector<AnalysisResult> analyze(float frequency, int sampleRate,
+                                    PhaseAccumulator accumulator,
+                                    const std::vector<std::size_t> &tableSizes);
+
+/**
+ * Fastest result with at least targetSnr dB SNR, or nullptr if none is
+ * good enough
+ */
+const AnalysisResult *cheapest(const std::vector<AnalysisResult> &results,
+                               double targetSnr);
+
+/**
+ * Print results and the cheapest combination meeting targetSnr as a table,
+ * or as JSON
+ */
+void printAnalysis(std::ostream &out,
+                   const std::vector<AnalysisResult> &results, float frequency,
+                   int sampleRate, PhaseAccumulator accumulator,
+                   double targetSnr, bool json);
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Block kernels for OscillatorBank. Each kernel renders n samples of the sum
+ * of voices linearly interpolating, fixed point phase oscillators to out and
+ * advances their phases. table holds size samples, size being a power of
+ * two, followed by guard points. phases, increments and amplitudes are arrays
+ * of voices elements, voices being a multiple of BANK_LANES.
+ *
+ * The vector kernels process BANK_LANES (or half of it) voices per
+ * instruction. Every voice is computed with the same float operations as
+ * the scalar kernel, but the voices are summed in a different order, so the
+ * results agree only to rounding.
+ */
+constexpr std::size_t BANK_LANES = 8;
+
+using BankKernel = void (*)(const float *table, std::size_t size,
+                            std::uint32_t *phases,
+                            const std::uint32_t *increments,
+                            const float *amplitudes, std::size_t voices,
+                            float *out, std::size_t n);
+
+void bankKernelScalar(const float *table, std::size_t size,
+                      std::uint32_t *phases, const std::uint32_t *increments,
+                      const float *amplitudes, std::size_t voices, float *out,
+                      std::size_t n);
+void bankKernelSse2(const float *table, std::size_t size,
+                    std::uint32_t *phases, const std::uint32_t *increments,
+                    const float *amplitudes, std::size_t voices, float *out,
+                    std::size_t n);
+void bankKernelAvx2(const float *table, std::size_t size,
+                    std::uint32_t *phases, const std::uint32_t *increments,
+                    const float *amplitudes, std::size_t voices, float *out,
+                    std::size_t n);
+
+/**
+ * Returns the fastest bank kernel supported by the running CPU
+ */
+BankKernel bestBankKernel();
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * Cubic interpolation between y1 and y2 at fraction, y0 and y3 being the
+ * outer neighbours. Shared by the scalar oscillator and the kernels so that
+ * every path does the same float operations in the same order.
+ */
+inline float cubicInterpolate(float y0, float y1, float y2, float y3,
+                              float fraction)
+{
+    auto tmp = y3 + 3 * y1;
+    auto fractionSquared = fraction * fraction;
+    auto fractionCubic = fraction * fractionSquared;
+
+    return fractionCubic * (-y0 - 3.f * y2 + tmp) / 6.f +
+           fractionSquared * ((y0 + y2) / 2.f - y1) +
+           fraction * (y2 + (-2.f * y0 - tmp) / 6.f) + y1;
+}
+
+/**
+ * Block kernels for cubic table lookup. Each kernel reads precomputed table
+ * phases (already wrapped to [0, size)) and writes amplitude scaled cubic
+ * interpolated samples to out. table holds size samples and two guard points.
+ *
+ * The vector kernels evaluate the exact same float operations in the same
+ * order as the scalar kernel, so their output is bit-identical to it (and to
+ * Oscillator<Cubic>::fill) as long as the compiler is not allowed
+ * to contract or reassociate floating point math (no -ffast-math).
+ */
+using CubicKernel = void (*)(const float *table, std::size_t size,
+                             const float *phases, float amplitude, float *out,
+                             std::size_t n);
+
+void cubicKernelScalar(const float *table, std::size_t size,
+                       const float *phases, float amplitude, float *out,
+                       std::size_t n);
+void cubicKernelSse2(const float *table, std::size_t size, const float *phases,
+                     float amplitude, float *out, std::size_t n);
+void cubicKernelAvx2(const float *table, std::size_t size, const float *phases,
+                     float amplitude, float *out, std::size_t n);
+
+/**
+ * Returns the fastest cubic kernel supported by the running CPU
+ */
+CubicKernel bestCubicKernel();
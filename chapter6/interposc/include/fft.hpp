@@ -0,0 +1,47 @@
+#pragma once
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+constexpr bool isPowerOfTwo(std::size_t n) { return n > 0 && !(n & (n - 1)); }
+
+/**
+ * In-place iterative radix-2 FFT. Size of x must be a power of two. The
+ * inverse transform is not scaled by 1/N.
+ */
+inline void fft(std::vector<std::complex<double>> &x, bool inverse)
+{
+    const auto n = x.size();
+
+    // Bit reversal permutation
+    for (std::size_t i = 1, j = 0; i < n; ++i)
+    {
+        auto bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(x[i], x[j]);
+    }
+
+    // Butterflies. Twiddles are computed directly rather than by repeated
+    // multiplication to keep the error independent of the transform size.
+    const double sign = inverse ? 1.0 : -1.0;
+    for (std::size_t len = 2; len <= n; len <<= 1)
+    {
+        const auto half = len / 2;
+        for (std::size_t j = 0; j < half; ++j)
+        {
+            const auto w = std::polar(1.0, sign * 2 * M_PI * j / len);
+            for (std::size_t i = 0; i < n; i += len)
+            {
+                const auto u = x[i + j];
+                const auto v = x[i + j + half] * w;
+                x[i + j] = u + v;
+                x[i + j + half] = u - v;
+            }
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "cubic_kernels.hpp"
+#include "table_size.hpp"
+#include "wavetable.hpp"
+#include <array>
+
+/*
+ * Table lookup policies for Oscillator. Each policy provides
+ *     template <typename Size>
+ *     static float lookup(const float *table, Size size, int index,
+ *                         float fraction)
+ * returning the value of table (including its two guard points) at index +
+ * fraction, where 0 <= index < size.size() and 0 <= fraction < 1. Size is
+ * one of the policies in table_size.hpp.
+ */
+
+/**
+ * Truncating lookup, no interpolation
+ */
+struct Truncate
+{
+    template <typename Size>
+    static float lookup(const float *table, Size, int index, float)
+    {
+        return table[index];
+    }
+};
+
+/**
+ * Linear interpolation between two neighbouring samples
+ */
+struct Linear
+{
+    template <typename Size>
+    static float lookup(const float *table, Size, int index, float fraction)
+    {
+        auto a = table[index];
+        auto b = table[index + 1];
+        return a + fraction * (b - a);
+    }
+};
+
+/**
+ * Cubic (Lagrange) interpolation, matches the SIMD cubic kernels
+ */
+struct Cubic
+{
+    template <typename Size>
+    static float lookup(const float *table, Size size, int index,
+                        float fraction)
+    {
+        auto y0 = index > 0 ? table[index - 1] : table[size.size() - 1];
+        return cubicInterpolate(y0, table[index], table[index + 1],
+                                table[index + 2], fraction);
+    }
+};
+
+/**
+ * 4-point, 3rd-order Hermite (Catmull-Rom) interpolation
+ */
+struct Hermite
+{
+    template <typename Size>
+    static float lookup(const float *table, Size size, int index,
+                        float fraction)
+    {
+        auto y0 = table[size.wrap(index - 1)];
+        auto y1 = table[index];
+        auto y2 = table[index + 1];
+        auto y3 = table[index + 2];
+
+        auto c1 = 0.5f * (y2 - y0);
+        auto c2 = y0 - 2.5f * y1 + 2.f * y2 - 0.5f * y3;
+        auto c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+        return ((c3 * fraction + c2) * fraction + c1) * fraction + y1;
+    }
+};
+
+/**
+ * 8-point Blackman windowed sinc interpolation. Coefficients are tabulated
+ * for SINC_PHASES fractional positions and interpolated linearly between.
+ */
+struct WindowedSinc
+{
+    static constexpr int TAPS = 8;
+    static constexpr int SINC_PHASES = 256;
+    using Coefficients = std::array<std::array<float, TAPS>, SINC_PHASES + 1>;
+
+    static const Coefficients &coefficients()
+    {
+        static const Coefficients coefs = [] {
+            Coefficients c;
+            constexpr double halfWidth = TAPS / 2;
+            for (int p = 0; p <= SINC_PHASES; ++p)
+            {
+                double sum = 0.0;
+                std::array<double, TAPS> h;
+                for (int k = 0; k < TAPS; ++k)
+                {
+                    // Distance of tap k from the interpolated position
+                    double x = k - (TAPS / 2 - 1) - (double)p / SINC_PHASES;
+                    double sinc = x == 0.0 ? 1.0 : sin(PI * x) / (PI * x);
+                    double window = 0.42 + 0.5 * cos(PI * x / halfWidth) +
+                                    0.08 * cos(2 * PI * x / halfWidth);
+                    h[k] = sinc * window;
+                    sum += h[k];
+                }
+                for (int k = 0; k < TAPS; ++k) // Unity gain at DC
+                    c[p][k] = (float)(h[k] / sum);
+            }
+            return c;
+        }();
+        return coefs;
+    }
+
+    template <typename Size>
+    static float lookup(const float *table, Size size, int index,
+                        float fraction)
+    {
+        static const Coefficients &coefs = coefficients();
+        auto position = fraction * SINC_PHASES;
+        auto p = (int)position;
+        auto f = position - p;
+        const auto &a = coefs[p];
+        const auto &b = coefs[p + 1];
+
+        float value = 0.f;
+        for (int k = 0; k < TAPS; ++k)
+        {
+            auto y = table[size.wrap(index + k - (TAPS / 2 - 1))];
+            value += (a[k] + f * (b[k] - a[k])) * y;
+        }
+        return value;
+    }
+};
@@ -0,0 +1,422 @@
+#pragma once
+#include "cubic_kernels.hpp"
+#include "lookup.hpp"
+#include "table_size.hpp"
+#include "wavetable.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+constexpr int DEFAULT_SAMPLE_RATE = 44100;
+
+enum class TableLookupType
+{
+    Truncating,
+    LinearInterpolation,
+    CubicInterpolation,
+    HermiteInterpolation,
+    SincInterpolation
+};
+
+enum class PhaseAccumulator
+{
+    Float, // float phase in table samples, wrapped with comparisons
+    Fixed  // 32-bit fixed point phase, wraps by integer overflow
+};
+
+/**
+ * Fixed point phase increment per sample of freq, as a fraction of 2^32.
+ * The 32-bit fixed point phase is a fraction of one cycle, wrapping by
+ * integer overflow; the table size policies in table_size.hpp split it into
+ * a table index and an interpolation fraction.
+ */
+inline std::uint32_t fixedPhaseIncrement(float freq, int sampleRate)
+{
+    const double cycles = static_cast<double>(freq) / sampleRate;
+    return static_cast<std::uint32_t>(
+        static_cast<std::int64_t>(std::llround(cycles * 4294967296.0)));
+}
+
+/**
+ * Fixed point phase of cycles, wrapped to one cycle. Written with 32-bit
+ * integer conversions only, so that loops over it vectorize. |cycles| must
+ * be less than 2^31; one least significant bit of the result is lost.
+ */
+inline std::uint32_t cyclesToFixed(float cycles)
+{
+    const float fraction = cycles - (float)(std::int32_t)cycles; // (-1, 1)
+    return (std::uint32_t)(std::int32_t)(fraction * 2147483648.f) << 1;
+}
+
+/**
+ * Table lookup oscillator. Lookup is one of the policies in lookup.hpp
+ * (Truncate, Linear, Cubic, Hermite, WindowedSinc); the choice is made at
+ * compile time so every render loop is specialized for its interpolation.
+ * Table size and sample rate are runtime parameters; render loops are
+ * instantiated for the common table sizes (see withTableSize()).
+ */
+template <typename Lookup> class Oscillator
+{
+    static constexpr std::size_t MODULATION_CHUNK = 256;
+    const Wavetable *wave;                // Wavetable to sample from
+    const WavetableSet *waveSet{nullptr}; // Band-limited levels, if any
+    float phase{0.0};                     // Current phase of oscillator
+    std::uint32_t fixedPhase{0};          // Current phase in fixed point mode
+    PhaseAccumulator accumulator{PhaseAccumulator::Float};
+    const int sampleRate;
+
+    /**
+     * Phase increment per sample as a fraction of 2^32
+     */
+    std::uint32_t fixedIncrement() const
+    {
+        return fixedPhaseIncrement(freq, sampleRate);
+    }
+
+    /**
+     * Phase increment per sample in table samples for the float accumulator
+     */
+    float floatIncrement() const
+    {
+        return freq * static_cast<float>(wave->size()) / sampleRate;
+    }
+
+    template <typename Size, typename Iter>
+    void fillRange(Size size, Iter begin, Iter end)
+    {
+        const float *table = wave->data();
+
+        if (accumulator == PhaseAccumulator::Fixed)
+        {
+            const auto increment = fixedIncrement();
+            auto p = fixedPhase;
+            for (auto i = begin; i != end; ++i)
+            {
+                *i = amplitude * Lookup::lookup(table, size, size.fixedIndex(p),
+                                                size.fixedFraction(p));
+                p += increment; // Wraps around at the end of the table
+            }
+            fixedPhase = p;
+            return;
+        }
+
+        const auto increment = floatIncrement();
+        const auto tableSize = static_cast<float>(size.size());
+        for (auto i = begin; i != end; ++i)
+        {
+            *i = amplitude *
+                 Lookup::lookup(table, size, (int)phase, phase - (int)phase);
+            phase += increment;
+            // Modulus for float value
+            while (phase >= tableSize)
+                phase -= tableSize;
+            while (phase < 0)
+                phase += tableSize;
+        }
+    }
+
+    /**
+     * Table phases of the next n samples for the block kernels, advancing
+     * the active accumulator
+     */
+    template <typename Size>
+    void blockPhases(Size size, float *phases, std::size_t n)
+    {
+        if (accumulator == PhaseAccumulator::Fixed)
+        {
+            const auto increment = fixedIncrement();
+            auto p = fixedPhase;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                phases[i] = size.fixedIndex(p) + size.fixedFraction(p);
+                p += increment;
+            }
+            fixedPhase = p;
+            return;
+        }
+
+        const auto increment = floatIncrement();
+        const auto tableSize = static_cast<float>(size.size());
+        auto p = phase; // Keep the accumulator in a register
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            phases[i] = p;
+            p += increment;
+            while (p >= tableSize)
+                p -= tableSize;
+            while (p < 0)
+                p += tableSize;
+        }
+        phase = p;
+    }
+
+    /**
+     * Table phases of the next n samples with per sample frequencies freqs
+     * (frequency modulation) and phase offsets in cycles (phase modulation),
+     * either of which may be nullptr. Increments and offsets are computed in
+     * loops without carried dependencies, so they vectorize; only the
+     * running sum of increments is serial.
+     */
+    template <typename Size>
+    void modulatedPhases(Size size, const float *freqs, const float *offsets,
+                         float *phases, std::size_t n)
+    {
+        if (accumulator == PhaseAccumulator::Fixed)
+        {
+            std::uint32_t increments[MODULATION_CHUNK], at[MODULATION_CHUNK];
+            const float cyclesPerHz = 1.f / sampleRate;
+            if (freqs)
+                for (std::size_t i = 0; i < n; ++i)
+                    increments[i] = cyclesToFixed(freqs[i] * cyclesPerHz);
+            else
+                std::fill(increments, increments + n, fixedIncrement());
+            auto p = fixedPhase;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                at[i] = p;
+                p += increments[i];
+            }
+            fixedPhase = p;
+            if (offsets)
+                for (std::size_t i = 0; i < n; ++i)
+                    at[i] += cyclesToFixed(offsets[i]);
+            for (std::size_t i = 0; i < n; ++i)
+                phases[i] = size.fixedIndex(at[i]) + size.fixedFraction(at[i]);
+            return;
+        }
+
+        const auto tableSize = static_cast<float>(size.size());
+        float increments[MODULATION_CHUNK];
+        if (freqs)
+        {
+            const float samplesPerHz = tableSize / sampleRate;
+            for (std::size_t i = 0; i < n; ++i)
+                increments[i] = freqs[i] * samplesPerHz;
+        }
+        else
+            std::fill(increments, increments + n, floatIncrement());
+        auto p = phase;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            phases[i] = p;
+            p += increments[i];
+            while (p >= tableSize)
+                p -= tableSize;
+            while (p < 0)
+                p += tableSize;
+        }
+        phase = p;
+        if (offsets)
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const auto fraction =
+                    offsets[i] - (float)(std::int32_t)offsets[i];
+                auto x = phases[i] + fraction * tableSize; // (-size, 2 size)
+                x = x >= tableSize ? x - tableSize : x < 0 ? x + tableSize : x;
+                phases[i] = x < tableSize ? x : 0.f; // x + size may round up
+            }
+    }
+
+    /**
+     * Render n samples at table phases, with the SIMD kernel for cubic
+     * lookup and the lookup policy for the rest
+     */
+    template <typename Size>
+    void renderPhases(Size size, const float *phases, float *out,
+                      std::size_t n)
+    {
+        if (std::is_same<Lookup, Cubic>::value)
+        {
+            bestCubicKernel()(wave->data(), size.size(), phases, amplitude, out,
+                              n);
+            return;
+        }
+        const float *table = wave->data();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const auto index = static_cast<int>(phases[i]);
+            out[i] = amplitude *
+                     Lookup::lookup(table, size, index, phases[i] - index);
+        }
+    }
+
+    /**
+     * Modulated fill, selecting the band-limited level for the highest
+     * frequency in the block
+     */
+    void fillModulated(float *out, const float *freqs, const float *offsets,
+                       std::size_t n)
+    {
+        if (waveSet)
+        {
+            float highest = std::abs(freq);
+            if (freqs)
+                for (std::size_t i = 0; i < n; ++i)
+                    highest = std::max(highest, std::abs(freqs[i]));
+            wave = &waveSet->forFrequency(highest);
+        }
+        float phases[MODULATION_CHUNK];
+        withTableSize(wave->size(), [&](auto size) {
+            for (std::size_t done = 0; done < n; done += MODULATION_CHUNK)
+            {
+                const auto count = std::min(n - done, MODULATION_CHUNK);
+                modulatedPhases(size, freqs ? freqs + done : nullptr,
+                                offsets ? offsets + done : nullptr, phases,
+                                count);
+                renderPhases(size, phases, out + done, count);
+            }
+        });
+    }
+
+    // Policies without a SIMD kernel render blocks with the generic loop
+    void fillBlock(float *out, std::size_t n, std::false_type)
+    {
+        fill(out, out + n);
+    }
+
+    void fillBlock(float *out, std::size_t n, std::true_type)
+    {
+        fill(out, n, bestCubicKernel());
+    }
+
+  public:
+    float amplitude{1.0}, freq;
+    Oscillator(float amp, const Wavetable &w, float freq,
+               int srate = DEFAULT_SAMPLE_RATE)
+        : wave(&w), sampleRate(srate), amplitude(amp), freq(freq)
+    {
+    }
+
+    /**
+     * Oscillator reading from a band-limited wavetable set. The level is
+     * chosen from freq at the start of every fill call.
+     */
+    Oscillator(float amp, const WavetableSet &set, float freq,
+               int srate = DEFAULT_SAMPLE_RATE)
+        : wave(&set.forFrequency(freq)), waveSet(&set), sampleRate(srate),
+          amplitude(amp), freq(freq)
+    {
+    }
+
+    /**
+     * Pick the wavetable level matching the current frequency
+     */
+    void selectLevel()
+    {
+        if (waveSet)
+            wave = &waveSet->forFrequency(freq);
+    }
+
+    /**
+     * Select phase accumulator, keeping the current phase
+     */
+    void setPhaseAccumulator(PhaseAccumulator acc)
+    {
+        if (acc == accumulator)
+            return;
+        const double tableSize = wave->size();
+        if (acc == PhaseAccumulator::Fixed)
+            fixedPhase = static_cast<std::uint32_t>(
+                static_cast<double>(phase) / tableSize * 4294967296.0);
+        else
+            phase = static_cast<float>(static_cast<double>(fixedPhase) /
+                                       4294967296.0 * tableSize);
+        accumulator = acc;
+    }
+
+    /**
+     * Skip frames samples ahead without rendering them. With the fixed point
+     * accumulator the resulting phase is exactly what rendering would have
+     * reached; the float accumulator only gets close to it, as its rounding
+     * depends on the sample by sample history.
+     */
+    void advance(std::uint64_t frames)
+    {
+        if (accumulator == PhaseAccumulator::Fixed)
+        {
+            fixedPhase += static_cast<std::uint32_t>(frames * fixedIncrement());
+            return;
+        }
+        const double tableSize = wave->size();
+        const double increment = (double)freq * tableSize / sampleRate;
+        auto p = std::fmod(phase + frames * increment, tableSize);
+        phase = static_cast<float>(p < 0 ? p + tableSize : p);
+        if (phase >= tableSize) // Rounded up to the table size
+            phase = 0.f;
+    }
+
+    /**
+     * Fill given range with lookups from oscillators wavetable
+     */
+    template <typename Iter> void fill(Iter begin, Iter end)
+    {
+        selectLevel();
+        withTableSize(wave->size(),
+                      [&](auto size) { fillRange(size, begin, end); });
+    }
+
+    /**
+     * Fill n samples at out, using the fastest available block kernel of
+     * the lookup policy
+     */
+    void fill(float *out, std::size_t n)
+    {
+        fillBlock(out, n, std::is_same<Lookup, Cubic>{});
+    }
+
+    /**
+     * Fill n samples at out with per sample frequencies freqs in Hz instead
+     * of freq (frequency modulation). freq still selects the starting level
+     * of a wavetable set. With freqs nullptr this is the constant frequency
+     * fill. Fixed point increments are computed in float precision here, so
+     * a constant freqs buffer does not reproduce fill() bit for bit.
+     */
+    void fillFm(float *out, const float *freqs, std::size_t n)
+    {
+        if (freqs == nullptr)
+            fill(out, n);
+        else
+            fillModulated(out, freqs, nullptr, n);
+    }
+
+    /**
+     * Fill n samples at out at frequency freq, offsetting the phase of every
+     * sample by offsets (in cycles, phase modulation). The offsets do not
+     * accumulate. With offsets nullptr this is the constant frequency fill.
+     */
+    void fillPm(float *out, const float *offsets, std::size_t n)
+    {
+        if (offsets == nullptr)
+            fill(out, n);
+        else
+            fillModulated(out, nullptr, offsets, n);
+    }
+
+    /**
+     * Fill n samples at out with cubic interpolation using a SIMD kernel.
+     * Output is bit-identical to the generic fill. With the float
+     * accumulator the phase recurrence stays serial (so it rounds exactly like
+     * the scalar path); the fixed point phases have no carried dependency
+     * other than the running sum and are computed a block at a time.
+     */
+    void fill(float *out, std::size_t n, CubicKernel kernel)
+    {
+        static_assert(std::is_same<Lookup, Cubic>::value,
+                      "SIMD kernels exist only for cubic lookup");
+        selectLevel();
+        constexpr std::size_t CHUNK = 256;
+        alignas(32) float phases[CHUNK];
+        withTableSize(wave->size(), [&](auto size) {
+            while (n > 0)
+            {
+                const auto count = std::min(n, CHUNK);
+                blockPhases(size, phases, count);
+                kernel(wave->data(), size.size(), phases, amplitude, out,
+                       count);
+                out += count;
+                n -= count;
+            }
+        });
+    }
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include "bank_kernels.hpp"
+#include "oscillator.hpp"
+#include "wavetable.hpp"
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Bank of linearly interpolating, fixed point phase oscillators sharing one
+ * wavetable and rendering the sum of their outputs. Voice state is stored as
+ * struct-of-arrays, so the kernels can compute several voices per
+ * instruction. Frequencies, amplitudes and phases may be changed between
+ * fill calls. The table size must be a power of two.
+ */
+class OscillatorBank
+{
+    const Wavetable *wave;
+    const int sampleRate;
+    std::size_t voices;
+    // Padded to a multiple of BANK_LANES with silent voices
+    std::vector<std::uint32_t> phases, increments;
+    std::vector<float> amplitudes;
+
+  public:
+    OscillatorBank(const Wavetable &w, std::size_t voices,
+                   int srate = DEFAULT_SAMPLE_RATE)
+        : wave(&w), sampleRate(srate), voices(voices)
+    {
+        if (!isPowerOfTwo(w.size()))
+            throw std::invalid_argument(
+                "OscillatorBank requires a power of two table size");
+        const auto padded = (voices + BANK_LANES - 1) / BANK_LANES * BANK_LANES;
+        phases.resize(padded, 0);
+        increments.resize(padded, 0);
+        amplitudes.resize(padded, 0.f);
+    }
+
+    std::size_t size() const { return voices; }
+
+    void setFrequency(std::size_t voice, float freq)
+    {
+        increments.at(voice) = fixedPhaseIncrement(freq, sampleRate);
+    }
+
+    void setAmplitude(std::size_t voice, float amp)
+    {
+        amplitudes.at(voice) = amp;
+    }
+
+    /**
+     * Set phase of voice in cycles. Phases outside [0, 1) are wrapped.
+     */
+    void setPhase(std::size_t voice, float phase)
+    {
+        // A tiny negative phase wraps to 1.0, so convert through int64_t
+        const double cycles = phase - std::floor(static_cast<double>(phase));
+        phases.at(voice) = static_cast<std::uint32_t>(
+            static_cast<std::int64_t>(cycles * 4294967296.0));
+    }
+
+    /**
+     * Fill n samples at out with the sum of all voices
+     */
+    void fill(float *out, std::size_t n) { fill(out, n, bestBankKernel()); }
+
+    void fill(float *out, std::size_t n, BankKernel kernel)
+    {
+        kernel(wave->data(), wave->size(), phases.data(), increments.data(),
+               amplitudes.data(), phases.size(), out, n);
+    }
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+ * On-disk cache of generated wavetables, in the file format of tabgen's
+ * tabcache.c: a 32 byte header ("WTAB", format version, generator version,
+ * waveform, harmonics, length, guard points and sample type as 32-bit
+ * integers) followed by the samples. Tables are stored one per file under
+ * $WAVETABLE_CACHE/interposc (by default ~/.cache/audioprogramming/interposc)
+ * and mapped read-only when loaded, so that concurrent processes share one
+ * physical copy. An empty WAVETABLE_CACHE disables the cache.
+ */
+
+struct TableKey
+{
+    std::uint32_t waveform;
+    std::uint32_t harmonics;
+    std::uint32_t length; // Samples in one cycle
+    std::uint32_t guards; // Guard points following the cycle
+};
+
+/**
+ * Float samples of the table of key (length + guards of them) mapped from
+ * the cache, or nullptr if it is not cached. The mapping is released with
+ * the last copy of the pointer.
+ */
+std::shared_ptr<const float> loadCachedTable(const TableKey &key);
+
+/**
+ * Store samples as the table of key. Written under a temporary name and
+ * renamed into place, so readers never see a partial table. Returns false
+ * if the cache is disabled or the table could not be written.
+ */
+bool storeCachedTable(const TableKey &key, const float *samples);
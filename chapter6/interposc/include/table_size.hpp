@@ -0,0 +1,114 @@
+#pragma once
+#include "fft.hpp"
+#include <cstddef>
+#include <cstdint>
+
+constexpr int ilog2(unsigned n) { return n > 1 ? 1 + ilog2(n / 2) : 0; }
+
+// Smallest number of bits that can index size samples
+constexpr int indexBits(std::size_t size)
+{
+    return size > 1 ? 1 + ilog2(static_cast<unsigned>(size - 1)) : 0;
+}
+
+// Range of supported table sizes. The upper bound leaves at least 8
+// interpolation fraction bits in a fixed point phase.
+constexpr std::size_t MIN_TABLE_SIZE = 16;
+constexpr std::size_t MAX_TABLE_SIZE = 1 << 16;
+
+/*
+ * Table size policies. Lookup policies and the oscillator render loops are
+ * templated on them, so that the common power of two sizes (StaticSize) get
+ * their masks and shifts folded into constants, while any other size
+ * (DynamicSize) still works at runtime.
+ *
+ * Both split a 32-bit fixed point phase (a fraction of one cycle) into a
+ * table index and a fraction with 24 - indexBits(size) bits, which is what a
+ * float phase in table samples can hold exactly. For power of two sizes the
+ * two policies give identical results.
+ */
+
+template <std::size_t N> struct StaticSize
+{
+    static_assert(isPowerOfTwo(N), "static table sizes are powers of two");
+    static constexpr int INDEX_SHIFT = 32 - ilog2(N);
+    static constexpr int FRACTION_BITS = 24 - ilog2(N);
+    static constexpr int FRACTION_SHIFT = INDEX_SHIFT - FRACTION_BITS;
+    static constexpr std::uint32_t FRACTION_MASK = (1u << FRACTION_BITS) - 1;
+
+    constexpr std::size_t size() const { return N; }
+
+    /**
+     * Index in [0, N) for an index less than one table away from it
+     */
+    int wrap(int index) const { return index & static_cast<int>(N - 1); }
+
+    int fixedIndex(std::uint32_t phase) const
+    {
+        return static_cast<int>(phase >> INDEX_SHIFT);
+    }
+
+    float fixedFraction(std::uint32_t phase) const
+    {
+        return ((phase >> FRACTION_SHIFT) & FRACTION_MASK) *
+               (1.f / (1u << FRACTION_BITS));
+    }
+};
+
+struct DynamicSize
+{
+    int n;
+    int fractionShift;   // Of the low 32 bits of phase * n
+    float fractionScale; // 2^-(fraction bits)
+
+    explicit DynamicSize(std::size_t size)
+        : n(static_cast<int>(size)), fractionShift(8 + indexBits(size)),
+          fractionScale(1.f / (1u << (32 - fractionShift)))
+    {
+    }
+
+    std::size_t size() const { return n; }
+
+    int wrap(int index) const
+    {
+        return index < 0 ? index + n : index >= n ? index - n : index;
+    }
+
+    int fixedIndex(std::uint32_t phase) const
+    {
+        return static_cast<int>((std::uint64_t)phase * n >> 32);
+    }
+
+    float fixedFraction(std::uint32_t phase) const
+    {
+        const auto position =
+            static_cast<std::uint32_t>((std::uint64_t)phase * n);
+        return (position >> fractionShift) * fractionScale;
+    }
+};
+
+/**
+ * Call f with the size policy for a table of size samples, StaticSize for
+ * the common sizes and DynamicSize for the rest. Dispatch once per block,
+ * not per sample.
+ */
+template <typename F> auto withTableSize(std::size_t size, F f)
+{
+    switch (size)
+    {
+    case 256:
+        return f(StaticSize<256>{});
+    case 512:
+        return f(StaticSize<512>{});
+    case 1024:
+        return f(StaticSize<1024>{});
+    case 2048:
+        return f(StaticSize<2048>{});
+    case 4096:
+        return f(StaticSize<4096>{});
+    case 8192:
+        return f(StaticSize<8192>{});
+    default:
+        return f(DynamicSize{size});
+    }
+}
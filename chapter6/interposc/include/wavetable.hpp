@@ -0,0 +1,226 @@
+#pragma once
+#define _USE_MATH_DEFINES
+#include "fft.hpp"
+#include "table_cache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+constexpr std::size_t DEFAULT_WAVETABLE_SIZE = 1024;
+constexpr auto PI = M_PI;
+
+enum class Waveform
+{
+    Sine,
+    Saw,
+    Square,
+    Triangle
+};
+
+template <typename Iter> void normalize(Iter begin, Iter end)
+{
+    auto peak = *std::max_element(begin, end);
+    auto scale = [peak](auto sample) { return sample * (1.0 / peak); };
+    std::transform(begin, end, begin, scale);
+}
+
+/**
+ * Synthesize one normalized table cycle of size samples (plus two guard
+ * points) from a harmonic spectrum. Power of two sizes use an inverse FFT,
+ * O(N log N) regardless of the number of harmonics; other sizes fall back to
+ * summing the harmonics directly.
+ * amplitudes[i] and phases[i] (radians, cosine phase) describe harmonic i + 1.
+ */
+inline auto spectrumTable(const std::vector<float> &amplitudes,
+                          const std::vector<float> &phases, std::size_t size)
+{
+    std::vector<float> table(size + 2, 0.f);
+    if (!isPowerOfTwo(size))
+    {
+        for (auto i = 0ul; i < amplitudes.size(); ++i)
+            for (auto n = 0ul; n < size + 2; ++n)
+            {
+                auto w = (i + 1) * (n * 2 * PI / size);
+                table[n] += (float)(amplitudes[i] * cos(w + phases.at(i)));
+            }
+        normalize(table.begin(), table.end());
+        return table;
+    }
+
+    std::vector<std::complex<double>> bins(size);
+    // Harmonics past the table size fold back just like when summed directly
+    for (auto i = 0ul; i < amplitudes.size(); ++i)
+        bins[(i + 1) % size] +=
+            (double)amplitudes[i] * std::polar(1.0, (double)phases.at(i));
+    fft(bins, true);
+
+    for (auto n = 0ul; n < size + 2; ++n)
+        table[n] = (float)bins[n % size].real();
+    normalize(table.begin(), table.end());
+    return table;
+}
+
+/**
+ * Table of harmonics sharing one phase offset (in cycles)
+ */
+inline auto fourierTable(const std::vector<float> &harmonicAmplitudes,
+                         float phaseOffset,
+                         std::size_t size = DEFAULT_WAVETABLE_SIZE)
+{
+    phaseOffset *= (float)PI * 2;
+    return spectrumTable(
+        harmonicAmplitudes,
+        std::vector<float>(harmonicAmplitudes.size(), phaseOffset), size);
+}
+
+class Wavetable
+{
+    static constexpr std::size_t GUARDS = 2;
+    // size() samples and GUARDS guard points, either owned or mapped from
+    // the table cache
+    std::shared_ptr<const float> table;
+    std::size_t length;
+
+    static std::vector<float> generate(Waveform waveform, int harmonics,
+                                       std::size_t size)
+    {
+        switch (waveform)
+        {
+        case Waveform::Sine:
+        {
+            std::vector<float> table(size + GUARDS);
+            // Phase of every point computed directly in double; summing a
+            // float increment drifts by several table steps in large tables
+            for (std::size_t i = 0; i < size + GUARDS; ++i)
+                table[i] = (float)sin(2 * PI * i / size);
+            return table;
+        }
+        case Waveform::Saw:
+        {
+            std::vector<float> harmAmps(harmonics, 0.f);
+            for (int i = 0; i < harmonics; ++i)
+                harmAmps[i] = 1.f / (i + 1);
+            return fourierTable(harmAmps, -0.25, size);
+        }
+        case Waveform::Square:
+        {
+            std::vector<float> harmAmps(harmonics, 0.f);
+            for (int i = 0; i < harmonics; i += 2)
+                harmAmps[i] = 1.f / (i + 1);
+            return fourierTable(harmAmps, -0.25, size);
+        }
+        case Waveform::Triangle:
+        {
+            std::vector<float> harmAmps(harmonics, 0.f);
+            for (int i = 0; i < harmonics; i += 2)
+                harmAmps[i] = 1.f / ((i + 1) * (i + 1));
+            return fourierTable(harmAmps, 0.0, size);
+        }
+        }
+        return std::vector<float>(size + GUARDS, 0.f);
+    }
+
+  public:
+    /**
+     * Table of waveform with harmonics partials. Loaded from the table
+     * cache when it has been generated before, generated and stored in the
+     * cache otherwise.
+     */
+    Wavetable(Waveform waveform, int harmonics,
+              std::size_t size = DEFAULT_WAVETABLE_SIZE)
+        : length(size)
+    {
+        // A sine has one partial whatever was asked for
+        const TableKey key{static_cast<std::uint32_t>(waveform),
+                           waveform == Waveform::Sine
+                               ? 1u
+                               : static_cast<std::uint32_t>(harmonics),
+                           static_cast<std::uint32_t>(size), GUARDS};
+        table = loadCachedTable(key);
+        if (table)
+            return;
+        auto samples = std::make_shared<std::vector<float>>(
+            generate(waveform, harmonics, size));
+        storeCachedTable(key, samples->data());
+        table = std::shared_ptr<const float>(samples, samples->data());
+    }
+    float operator[](const std::size_t idx) const { return table.get()[idx]; }
+    // Samples in one cycle, excluding the guard points
+    std::size_t size() const { return length; }
+    // Raw samples including the two guard points, for the SIMD kernels
+    const float *data() const { return table.get(); }
+};
+
+/**
+ * Band-limited set of wavetables, one per octave. Level k contains only the
+ * harmonics that stay below Nyquist for every frequency it is used for,
+ * highest level being a pure sine. Sets are immutable once built; use
+ * WavetableSet::get() to share one set between any number of oscillators.
+ */
+class WavetableSet
+{
+    std::vector<Wavetable> levels;
+    std::vector<int> harmonics; // Highest harmonic of each level
+    float nyquist;
+
+  public:
+    // Most harmonics a table of tableSize samples can represent
+    static int maxHarmonics(std::size_t tableSize)
+    {
+        return static_cast<int>(tableSize / 2 - 1);
+    }
+
+    WavetableSet(Waveform waveform, int sampleRate,
+                 std::size_t tableSize = DEFAULT_WAVETABLE_SIZE)
+        : nyquist(sampleRate / 2.f)
+    {
+        if (waveform == Waveform::Sine)
+        {
+            levels.emplace_back(waveform, 1, tableSize);
+            harmonics.push_back(1);
+            return;
+        }
+        for (int h = maxHarmonics(tableSize); h >= 1; h /= 2)
+        {
+            levels.emplace_back(waveform, h, tableSize);
+            harmonics.push_back(h);
+        }
+    }
+
+    /**
+     * Table with the most harmonics that does not alias at freq
+     */
+    const Wavetable &forFrequency(float freq) const
+    {
+        freq = std::abs(freq);
+        std::size_t level = 0;
+        while (level + 1 < levels.size() && freq * harmonics[level] > nyquist)
+            ++level;
+        return levels[level];
+    }
+
+    std::size_t size() const { return levels.size(); }
+
+    /**
+     * Shared set for waveform, sample rate and table size. Built on first
+     * request, then reused for the lifetime of the process. Thread-safe.
+     */
+    static const WavetableSet &
+    get(Waveform waveform, int sampleRate,
+        std::size_t tableSize = DEFAULT_WAVETABLE_SIZE)
+    {
+        static std::mutex mutex;
+        static std::map<std::tuple<Waveform, int, std::size_t>,
+                        std::unique_ptr<const WavetableSet>>
+            sets;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &set = sets[std::make_tuple(waveform, sampleRate, tableSize)];
+        if (!set)
+            set.reset(new WavetableSet(waveform, sampleRate, tableSize));
+        return *set;
+    }
+};
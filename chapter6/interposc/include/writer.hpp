@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sndfile.h>
+#include <thread>
+#include <vector>
+
+/**
+ * Writes blocks of samples to a sound file on a dedicated thread, so that
+ * synthesis of the next block overlaps with writing the previous ones.
+ * Usage: fill the block returned by acquire(), pass its length to submit(),
+ * repeat, and call finish() at the end.
+ */
+class AsyncWriter
+{
+    SNDFILE *file;
+    std::vector<std::vector<float>> blocks;
+    std::deque<std::size_t> freeBlocks;
+    std::deque<std::pair<std::size_t, std::size_t>> filled; // block, length
+    std::size_t current{0};       // Block handed out by acquire()
+    std::size_t framesWritten{0}; // Total written by the writer thread
+    bool finished{false}, failed{false};
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread writer;
+
+    void run();
+
+  public:
+    AsyncWriter(SNDFILE *file, std::size_t blockSize, std::size_t nblocks = 3);
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+    ~AsyncWriter();
+
+    /**
+     * Wait for a free block and return it, or nullptr if writing has failed
+     */
+    float *acquire();
+
+    /**
+     * Queue the first length samples of the acquired block for writing
+     */
+    void submit(std::size_t length);
+
+    /**
+     * Wait until every submitted block is written. Returns frames written.
+     */
+    std::size_t finish();
+};
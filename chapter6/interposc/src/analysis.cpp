@@ -0,0 +1,228 @@
+/*
+ *  Interpolation quality and cost analysis for interposc
+ */
+#include "analysis.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <iomanip>
+
+constexpr std::size_t ANALYSIS_BLOCK = 4096;
+constexpr int MAX_HARMONIC = 10;
+constexpr int TIMING_RUNS = 3;
+
+const char *lookupName(TableLookupType lookup)
+{
+    switch (lookup)
+    {
+    case TableLookupType::Truncating:
+        return "truncate";
+    case TableLookupType::LinearInterpolation:
+        return "linear";
+    case TableLookupType::CubicInterpolation:
+        return "cubic";
+    case TableLookupType::HermiteInterpolation:
+        return "hermite";
+    case TableLookupType::SincInterpolation:
+        return "sinc";
+    }
+    return "unknown";
+}
+
+/**
+ * Lookup "policy" returning the table phase the oscillator reads at, so the
+ * ideal output can be computed for the very same phases
+ */
+struct PhaseProbe
+{
+    template <typename Size>
+    static float lookup(const float *, Size, int index, float fraction)
+    {
+        return index + fraction;
+    }
+};
+
+/**
+ * Amplitude of the component of x at freq, measured through a Hann window
+ */
+static double amplitudeAt(const std::vector<double> &x, double freq,
+                          int sampleRate)
+{
+    std::complex<double> sum;
+    double windowSum = 0.0;
+    const auto n = x.size();
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double window = 0.5 - 0.5 * std::cos(2 * PI * i / (n - 1));
+        sum += window * x[i] * std::polar(1.0, -2 * PI * freq * i / sampleRate);
+        windowSum += window;
+    }
+    return 2 * std::abs(sum) / windowSum;
+}
+
+/**
+ * Render one second of a unit sine with lookup policy Lookup, measure its
+ * error against sin() and time the block fill. The reference is evaluated at
+ * the phases the oscillator actually reads at, so the frequency error of the
+ * phase accumulator is not counted against the lookup.
+ */
+template <typename Lookup>
+static AnalysisResult measure(TableLookupType type, std::size_t tableSize,
+                              float frequency, int sampleRate,
+                              PhaseAccumulator accumulator)
+{
+    const Wavetable table{Waveform::Sine, 1, tableSize};
+    auto makeOscillator = [&]() {
+        Oscillator<Lookup> osc{1.f, table, frequency, sampleRate};
+        osc.setPhaseAccumulator(accumulator);
+        return osc;
+    };
+
+    const std::size_t frames = sampleRate;
+    std::vector<float> out(frames), phases(frames);
+    auto osc = makeOscillator();
+    Oscillator<PhaseProbe> probe{1.f, table, frequency, sampleRate};
+    probe.setPhaseAccumulator(accumulator);
+    for (std::size_t i = 0; i < frames; i += ANALYSIS_BLOCK)
+    {
+        const auto n = std::min(ANALYSIS_BLOCK, frames - i);
+        osc.fill(out.data() + i, n);
+        probe.fill(phases.data() + i, n);
+    }
+
+    std::vector<double> error(frames);
+    double signalEnergy = 0.0, errorEnergy = 0.0;
+    for (std::size_t i = 0; i < frames; ++i)
+    {
+        const double ideal = std::sin(2 * PI * phases[i] / tableSize);
+        error[i] = out[i] - ideal;
+        signalEnergy += ideal * ideal;
+        errorEnergy += error[i] * error[i];
+    }
+
+    // Harmonics of the output are those of the error, the ideal signal
+    // having none. Measuring them from the error keeps the leakage of the
+    // fundamental out of the result.
+    double harmonicEnergy = 0.0;
+    for (int k = 2; k <= MAX_HARMONIC && k * frequency < sampleRate / 2.f; ++k)
+    {
+        const auto a = amplitudeAt(error, (double)k * frequency, sampleRate);
+        harmonicEnergy += a * a;
+    }
+
+    // Best of a few runs, the others being disturbed by something else
+    std::vector<float> block(ANALYSIS_BLOCK);
+    double best = INFINITY;
+    for (int run = 0; run < TIMING_RUNS; ++run)
+    {
+        auto timed = makeOscillator();
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < frames; i += ANALYSIS_BLOCK)
+            timed.fill(block.data(), std::min(ANALYSIS_BLOCK, frames - i));
+        const auto end = std::chrono::steady_clock::now();
+        using ns = std::chrono::duration<double, std::nano>;
+        best = std::min(best, ns(end - start).count());
+    }
+
+    // Fundamental amplitude is one, so THD is the harmonic energy as such
+    return {type, tableSize, 10 * std::log10(signalEnergy / errorEnergy),
+            10 * std::log10(harmonicEnergy), best / frames};
+}
+
+std::vector<AnalysisResult> analyze(float frequency, int sampleRate,
+                                    PhaseAccumulator accumulator,
+                                    const std::vector<std::size_t> &tableSizes)
+{
+    std::vector<AnalysisResult> results;
+    for (auto size : tableSizes)
+    {
+        results.push_back(measure<Truncate>(TableLookupType::Truncating, size,
+                                            frequency, sampleRate,
+                                            accumulator));
+        results.push_back(
+            measure<Linear>(TableLookupType::LinearInterpolation, size,
+                            frequency, sampleRate, accumulator));
+        results.push_back(
+            measure<Cubic>(TableLookupType::CubicInterpolation, size,
+                           frequency, sampleRate, accumulator));
+        results.push_back(
+            measure<Hermite>(TableLookupType::HermiteInterpolation, size,
+                             frequency, sampleRate, accumulator));
+        results.push_back(
+            measure<WindowedSinc>(TableLookupType::SincInterpolation, size,
+                                  frequency, sampleRate, accumulator));
+    }
+    return results;
+}
+
+const AnalysisResult *cheapest(const std::vector<AnalysisResult> &results,
+                               double targetSnr)
+{
+    const AnalysisResult *best = nullptr;
+    for (const auto &r : results)
+        if (r.snr >= targetSnr && (!best || r.nsPerSample < best->nsPerSample))
+            best = &r;
+    return best;
+}
+
+static void printJson(std::ostream &out, const AnalysisResult &r)
+{
+    out << "{\"lookup\": \"" << lookupName(r.lookup)
+        << "\", \"tableSize\": " << r.tableSize << ", \"snr\": " << r.snr
+        << ", \"thd\": " << r.thd << ", \"nsPerSample\": " << r.nsPerSample
+        << "}";
+}
+
+void printAnalysis(std::ostream &out,
+                   const std::vector<AnalysisResult> &results, float frequency,
+                   int sampleRate, PhaseAccumulator accumulator,
+                   double targetSnr, bool json)
+{
+    const auto best = cheapest(results, targetSnr);
+    const auto phase =
+        accumulator == PhaseAccumulator::Fixed ? "fixed" : "float";
+
+    if (json)
+    {
+        out << "{\n  \"frequency\": " << frequency
+            << ",\n  \"sampleRate\": " << sampleRate
+            << ",\n  \"phaseAccumulator\": \"" << phase
+            << "\",\n  \"targetSnr\": " << targetSnr
+            << ",\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            out << (i > 0 ? ",\n    " : "\n    ");
+            printJson(out, results[i]);
+        }
+        out << "\n  ],\n  \"cheapest\": ";
+        if (best)
+            printJson(out, *best);
+        else
+            out << "null";
+        out << "\n}\n";
+        return;
+    }
+
+    out << "Sine at " << frequency << " Hz, sample rate " << sampleRate
+        << ", " << phase << " phase\n"
+        << std::setw(10) << std::left << "lookup" << std::right
+        << std::setw(8) << "size" << std::setw(10) << "SNR dB"
+        << std::setw(10) << "THD dB" << std::setw(12) << "ns/sample"
+        << "\n";
+    out << std::fixed;
+    for (const auto &r : results)
+        out << std::setw(10) << std::left << lookupName(r.lookup) << std::right
+            << std::setw(8) << r.tableSize << std::setprecision(1)
+            << std::setw(10) << r.snr << std::setw(10) << r.thd
+            << std::setprecision(2) << std::setw(12) << r.nsPerSample << "\n";
+    if (best)
+        out << "Cheapest with at least " << std::setprecision(1) << targetSnr
+            << " dB SNR: " << lookupName(best->lookup) << " lookup, "
+            << best->tableSize << " sample table ("
+            << std::setprecision(2) << best->nsPerSample << " ns/sample)\n";
+    else
+        out << "No combination reaches " << std::setprecision(1) << targetSnr
+            << " dB SNR\n";
+    out << std::defaultfloat;
+}
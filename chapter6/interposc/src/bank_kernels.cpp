@@ -0,0 +1,207 @@
+/*
+ *  SSE2 and AVX2 kernels for the oscillator bank, vectorized across voices
+ */
+#include "bank_kernels.hpp"
+#include "table_size.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+// Samples rendered per pass over the voices. The per sample partial sums of
+// one pass (CHUNK * BANK_LANES floats) stay in L1 cache.
+constexpr std::size_t CHUNK = 256;
+
+/*
+ * Fixed point phase layout for a power of two table, as in StaticSize: the
+ * index is the top bits, the fraction the next 24 - index bits.
+ */
+constexpr int FRACTION_SHIFT = 8;
+
+struct PhaseLayout
+{
+    int indexShift;
+    std::uint32_t fractionMask;
+    float fractionScale;
+
+    explicit PhaseLayout(std::size_t size)
+        : indexShift(32 - ilog2(size)),
+          fractionMask((1u << (indexShift - FRACTION_SHIFT)) - 1),
+          fractionScale(1.f / (1u << (indexShift - FRACTION_SHIFT)))
+    {
+    }
+};
+
+void bankKernelScalar(const float *table, std::size_t size,
+                      std::uint32_t *phases, const std::uint32_t *increments,
+                      const float *amplitudes, std::size_t voices, float *out,
+                      std::size_t n)
+{
+    const PhaseLayout layout{size};
+    std::fill(out, out + n, 0.f);
+    for (std::size_t v = 0; v < voices; ++v)
+    {
+        auto p = phases[v];
+        const auto increment = increments[v];
+        const auto amplitude = amplitudes[v];
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const auto index = static_cast<int>(p >> layout.indexShift);
+            const auto fraction =
+                ((p >> FRACTION_SHIFT) & layout.fractionMask) *
+                layout.fractionScale;
+            const auto a = table[index];
+            const auto b = table[index + 1];
+            out[i] += amplitude * (a + fraction * (b - a));
+            p += increment;
+        }
+        phases[v] = p;
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+void bankKernelSse2(const float *table, std::size_t size,
+                    std::uint32_t *phases, const std::uint32_t *increments,
+                    const float *amplitudes, std::size_t voices, float *out,
+                    std::size_t n)
+{
+    const PhaseLayout layout{size};
+    const __m128i indexShift = _mm_cvtsi32_si128(layout.indexShift);
+    const __m128i fractionMask = _mm_set1_epi32(layout.fractionMask);
+    const __m128 fractionScale = _mm_set1_ps(layout.fractionScale);
+    alignas(16) float sums[CHUNK * 4];
+
+    for (std::size_t start = 0; start < n; start += CHUNK)
+    {
+        const auto count = std::min(CHUNK, n - start);
+        std::fill(sums, sums + count * 4, 0.f);
+        for (std::size_t v = 0; v < voices; v += 4)
+        {
+            auto p = _mm_loadu_si128(reinterpret_cast<__m128i *>(phases + v));
+            const __m128i increment = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(increments + v));
+            const __m128 amp = _mm_loadu_ps(amplitudes + v);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                // SSE2 has no gather, so load the taps of each lane by hand
+                alignas(16) int idx[4];
+                _mm_store_si128(reinterpret_cast<__m128i *>(idx),
+                                _mm_srl_epi32(p, indexShift));
+                const __m128 fraction = _mm_mul_ps(
+                    _mm_cvtepi32_ps(_mm_and_si128(
+                        _mm_srli_epi32(p, FRACTION_SHIFT), fractionMask)),
+                    fractionScale);
+                const __m128 a = _mm_setr_ps(table[idx[0]], table[idx[1]],
+                                             table[idx[2]], table[idx[3]]);
+                const __m128 b =
+                    _mm_setr_ps(table[idx[0] + 1], table[idx[1] + 1],
+                                table[idx[2] + 1], table[idx[3] + 1]);
+                const __m128 value = _mm_mul_ps(
+                    amp, _mm_add_ps(a, _mm_mul_ps(fraction, _mm_sub_ps(b, a))));
+                float *sum = sums + i * 4;
+                _mm_store_ps(sum, _mm_add_ps(_mm_load_ps(sum), value));
+                p = _mm_add_epi32(p, increment);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(phases + v), p);
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const float *sum = sums + i * 4;
+            out[start + i] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+        }
+    }
+}
+
+__attribute__((target("avx2"))) void
+bankKernelAvx2(const float *table, std::size_t size, std::uint32_t *phases,
+               const std::uint32_t *increments, const float *amplitudes,
+               std::size_t voices, float *out, std::size_t n)
+{
+    const PhaseLayout layout{size};
+    const __m128i indexShift = _mm_cvtsi32_si128(layout.indexShift);
+    const __m256i fractionMask = _mm256_set1_epi32(layout.fractionMask);
+    const __m256 fractionScale = _mm256_set1_ps(layout.fractionScale);
+    alignas(32) float sums[CHUNK * 8];
+
+    for (std::size_t start = 0; start < n; start += CHUNK)
+    {
+        const auto count = std::min(CHUNK, n - start);
+        std::fill(sums, sums + count * 8, 0.f);
+        for (std::size_t v = 0; v < voices; v += 8)
+        {
+            auto p =
+                _mm256_loadu_si256(reinterpret_cast<__m256i *>(phases + v));
+            const __m256i increment = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(increments + v));
+            const __m256 amp = _mm256_loadu_ps(amplitudes + v);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const __m256i index = _mm256_srl_epi32(p, indexShift);
+                const __m256 fraction = _mm256_mul_ps(
+                    _mm256_cvtepi32_ps(_mm256_and_si256(
+                        _mm256_srli_epi32(p, FRACTION_SHIFT),
+                        fractionMask)),
+                    fractionScale);
+                const __m256 a = _mm256_i32gather_ps(table, index, 4);
+                const __m256 b = _mm256_i32gather_ps(table + 1, index, 4);
+                const __m256 value = _mm256_mul_ps(
+                    amp, _mm256_add_ps(
+                             a, _mm256_mul_ps(fraction, _mm256_sub_ps(b, a))));
+                float *sum = sums + i * 8;
+                _mm256_store_ps(sum, _mm256_add_ps(_mm256_load_ps(sum), value));
+                p = _mm256_add_epi32(p, increment);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(phases + v), p);
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const __m256 sum = _mm256_load_ps(sums + i * 8);
+            __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum),
+                                     _mm256_extractf128_ps(sum, 1));
+            half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+            half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+            out[start + i] = _mm_cvtss_f32(half);
+        }
+    }
+}
+
+static BankKernel detectBankKernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return bankKernelAvx2;
+    return bankKernelSse2;
+}
+
+BankKernel bestBankKernel()
+{
+    static const BankKernel kernel = detectBankKernel();
+    return kernel;
+}
+
+#else // Not x86: fall back to the scalar kernel
+
+void bankKernelSse2(const float *table, std::size_t size,
+                    std::uint32_t *phases, const std::uint32_t *increments,
+                    const float *amplitudes, std::size_t voices, float *out,
+                    std::size_t n)
+{
+    bankKernelScalar(table, size, phases, increments, amplitudes, voices, out,
+                     n);
+}
+
+void bankKernelAvx2(const float *table, std::size_t size,
+                    std::uint32_t *phases, const std::uint32_t *increments,
+                    const float *amplitudes, std::size_t voices, float *out,
+                    std::size_t n)
+{
+    bankKernelScalar(table, size, phases, increments, amplitudes, voices, out,
+                     n);
+}
+
+BankKernel bestBankKernel() { return bankKernelScalar; }
+
+#endif
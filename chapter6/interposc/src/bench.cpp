@@ -0,0 +1,303 @@
+/*
+ *  Benchmark for the table lookup kernels of interposc
+ *  Usage: ./bench [seconds of audio]
+ */
+#include "oscillator.hpp"
+#include "oscillator_bank.hpp"
+#include "wavetable.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+constexpr int BUF_SIZE = 512;
+
+/**
+ * Render frames samples with fill, one BUF_SIZE buffer at a time like
+ * interposc does, and return elapsed nanoseconds per sample.
+ */
+template <typename Fill> double nsPerSample(std::size_t frames, Fill fill)
+{
+    std::vector<float> buf(BUF_SIZE, 0.f);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < frames; i += BUF_SIZE)
+        fill(buf.data(), std::min<std::size_t>(BUF_SIZE, frames - i));
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           frames;
+}
+
+/**
+ * Render frames samples with fill into a single vector
+ */
+template <typename Fill>
+std::vector<float> render(std::size_t frames, Fill fill)
+{
+    std::vector<float> out(frames, 0.f);
+    for (std::size_t i = 0; i < frames; i += BUF_SIZE)
+        fill(out.data() + i, std::min<std::size_t>(BUF_SIZE, frames - i));
+    return out;
+}
+
+/**
+ * Table synthesis by direct summation of cosines, O(harmonics * N). This is
+ * how fourierTable worked before FFT synthesis; kept as the reference.
+ */
+auto fourierTableDirect(const std::vector<float> &harmonicAmplitudes,
+                        float phaseOffset)
+{
+    std::vector<float> table(DEFAULT_WAVETABLE_SIZE + 2, 0.f);
+    phaseOffset *= (float)PI * 2;
+
+    for (auto i = 0ul; i < harmonicAmplitudes.size(); ++i)
+        for (auto n = 0ul; n < DEFAULT_WAVETABLE_SIZE + 2; ++n)
+        {
+            auto a = harmonicAmplitudes.at(i);
+            auto w = (i + 1) * (n * 2 * PI / DEFAULT_WAVETABLE_SIZE);
+            table[n] += (float)(a * cos(w + phaseOffset));
+        }
+    normalize(table.begin(), table.end());
+    return table;
+}
+
+/**
+ * Time building a saw table with fourierTable and by direct summation
+ */
+void benchTableSynthesis()
+{
+    constexpr int REPEATS = 20;
+    std::vector<float> harmAmps(
+        WavetableSet::maxHarmonics(DEFAULT_WAVETABLE_SIZE));
+    for (auto i = 0ul; i < harmAmps.size(); ++i)
+        harmAmps[i] = 1.f / (i + 1);
+
+    std::vector<float> direct, spectral;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; ++i)
+        direct = fourierTableDirect(harmAmps, -0.25);
+    auto mid = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; ++i)
+        spectral = fourierTable(harmAmps, -0.25);
+    auto end = std::chrono::steady_clock::now();
+
+    float diff = 0.f;
+    for (auto i = 0ul; i < direct.size(); ++i)
+        diff = std::max(diff, std::abs(direct[i] - spectral[i]));
+    using ms = std::chrono::duration<double, std::milli>;
+    std::cout << "Saw table synthesis, " << harmAmps.size() << " harmonics, "
+              << DEFAULT_WAVETABLE_SIZE << " samples\n"
+              << "  direct: " << ms(mid - start).count() / REPEATS << " ms\n"
+              << "  fft: " << ms(end - mid).count() / REPEATS
+              << " ms (max difference to direct " << diff << ")\n";
+}
+
+/**
+ * Time the block fill of lookup policy Lookup
+ */
+template <typename Lookup>
+void benchLookup(const char *name, const Wavetable &wavetable,
+                 std::size_t frames)
+{
+    auto osc = Oscillator<Lookup>{1.f, wavetable, 440.f};
+    osc.setPhaseAccumulator(PhaseAccumulator::Fixed);
+    std::cout << "  " << name << ": "
+              << nsPerSample(frames,
+                             [&osc](float *out, std::size_t n) {
+                                 osc.fill(out, n);
+                             })
+              << " ns/sample\n";
+}
+
+/**
+ * Time linear lookup from tables of different sizes. 1024 and 4096 use the
+ * compile time size policy, the others the runtime one.
+ */
+void benchTableSizes(std::size_t frames)
+{
+    std::cout << "Linear interpolation by table size, fixed phase, " << frames
+              << " samples\n";
+    for (std::size_t size : {1024, 1000, 4096, 4000, 65536})
+    {
+        const auto wavetable = Wavetable{Waveform::Saw, 40, size};
+        auto osc = Oscillator<Linear>{1.f, wavetable, 440.f};
+        osc.setPhaseAccumulator(PhaseAccumulator::Fixed);
+        std::cout << "  " << size << ": "
+                  << nsPerSample(frames,
+                                 [&osc](float *out, std::size_t n) {
+                                     osc.fill(out, n);
+                                 })
+                  << " ns/sample\n";
+    }
+}
+
+/**
+ * Time constant frequency fill against frequency and phase modulated fills
+ * of policy Lookup. The modulator completes one cycle per BUF_SIZE buffer
+ * (about 86 Hz), with a deviation of 20 Hz in FM and 0.1 cycles in PM.
+ */
+template <typename Lookup>
+void benchModulation(const char *name, const Wavetable &wavetable,
+                     std::size_t frames)
+{
+    std::vector<float> freqs(BUF_SIZE), offsets(BUF_SIZE);
+    for (int i = 0; i < BUF_SIZE; ++i)
+    {
+        const auto modulator = std::sin(2 * (float)PI * i / BUF_SIZE);
+        freqs[i] = 440.f + 20.f * modulator;
+        offsets[i] = 0.1f * modulator;
+    }
+    auto osc = Oscillator<Lookup>{1.f, wavetable, 440.f};
+    osc.setPhaseAccumulator(PhaseAccumulator::Fixed);
+    std::cout << "  " << name << " constant: "
+              << nsPerSample(frames,
+                             [&osc](float *out, std::size_t n) {
+                                 osc.fill(out, n);
+                             })
+              << " ns/sample, FM: "
+              << nsPerSample(frames,
+                             [&osc, &freqs](float *out, std::size_t n) {
+                                 osc.fillFm(out, freqs.data(), n);
+                             })
+              << " ns/sample, PM: "
+              << nsPerSample(frames,
+                             [&osc, &offsets](float *out, std::size_t n) {
+                                 osc.fillPm(out, offsets.data(), n);
+                             })
+              << " ns/sample\n";
+}
+
+float maxDifference(const std::vector<float> &a, const std::vector<float> &b)
+{
+    float diff = 0.f;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    return diff;
+}
+
+/**
+ * Time a cluster of detuned voices spread over one octave with each bank
+ * kernel, and report throughput in voice samples per second
+ */
+void benchBank(const Wavetable &wavetable, std::size_t frames)
+{
+    struct
+    {
+        const char *name;
+        BankKernel kernel;
+    } kernels[] = {{"scalar", bankKernelScalar},
+                   {"sse2", bankKernelSse2},
+                   {"avx2", bankKernelAvx2}};
+    // Fill function rendering a fresh cluster of voices with kernel
+    auto cluster = [&wavetable](std::size_t voices, BankKernel kernel) {
+        OscillatorBank bank{wavetable, voices};
+        for (std::size_t v = 0; v < voices; ++v)
+        {
+            bank.setFrequency(v, 220.f * std::exp2((float)v / voices));
+            bank.setAmplitude(v, 1.f / voices);
+            bank.setPhase(v, (float)v / voices);
+        }
+        return [bank, kernel](float *out, std::size_t n) mutable {
+            bank.fill(out, n, kernel);
+        };
+    };
+
+    for (std::size_t voices : {16, 256, 4096})
+    {
+        // Same amount of work for every voice count
+        const auto n = std::max<std::size_t>(BUF_SIZE, frames * 64 / voices);
+        std::cout << "Oscillator bank, " << voices << " voices, " << n
+                  << " samples\n";
+        const auto reference = render(n, cluster(voices, bankKernelScalar));
+        for (const auto &k : kernels)
+        {
+            if (k.kernel == bankKernelAvx2 && bestBankKernel() != k.kernel)
+            {
+                std::cout << "  " << k.name << ": not supported by this CPU\n";
+                continue;
+            }
+            const auto ns = nsPerSample(n, cluster(voices, k.kernel));
+            std::cout << "  " << k.name << ": " << voices * 1e3 / ns
+                      << " M voice samples/s (max difference to scalar "
+                      << maxDifference(reference,
+                                       render(n, cluster(voices, k.kernel)))
+                      << ")\n";
+        }
+    }
+}
+
+auto main(int argc, char const *argv[]) -> int
+{
+    double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 60.0;
+    if (seconds <= 0.0)
+    {
+        std::cerr << "Error: duration must be positive\n";
+        return EXIT_FAILURE;
+    }
+    const auto frames = static_cast<std::size_t>(seconds * DEFAULT_SAMPLE_RATE);
+    const auto wavetable = Wavetable{Waveform::Saw, 40};
+
+    benchTableSynthesis();
+
+    std::cout << "Lookup policies, fixed phase, " << frames << " samples\n";
+    benchLookup<Truncate>("truncate", wavetable, frames);
+    benchLookup<Linear>("linear", wavetable, frames);
+    benchLookup<Cubic>("cubic", wavetable, frames);
+    benchLookup<Hermite>("hermite", wavetable, frames);
+    benchLookup<WindowedSinc>("sinc", wavetable, frames);
+    benchTableSizes(frames);
+    std::cout << "Modulated fill, fixed phase, " << frames << " samples\n";
+    benchModulation<Linear>("linear", wavetable, frames);
+    benchModulation<Cubic>("cubic", wavetable, frames);
+
+    struct
+    {
+        const char *name;
+        PhaseAccumulator accumulator;
+    } accumulators[] = {{"float", PhaseAccumulator::Float},
+                        {"fixed", PhaseAccumulator::Fixed}};
+    struct
+    {
+        const char *name;
+        CubicKernel kernel;
+    } kernels[] = {{"sse2", cubicKernelSse2}, {"avx2", cubicKernelAvx2}};
+
+    for (const auto &acc : accumulators)
+    {
+        std::cout << "Cubic interpolation, " << acc.name << " phase, "
+                  << frames << " samples\n";
+        auto scalar = [&wavetable, &acc]() {
+            auto osc = Oscillator<Cubic>{1.f, wavetable, 440.f};
+            osc.setPhaseAccumulator(acc.accumulator);
+            return [osc](float *out, std::size_t n) mutable {
+                osc.fill(out, out + n);
+            };
+        };
+        std::cout << "  scalar: " << nsPerSample(frames, scalar())
+                  << " ns/sample\n";
+        const auto reference = render(frames, scalar());
+
+        for (const auto &k : kernels)
+        {
+            if (k.kernel == cubicKernelAvx2 && bestCubicKernel() != k.kernel)
+            {
+                std::cout << "  " << k.name << ": not supported by this CPU\n";
+                continue;
+            }
+            auto simd = [&wavetable, &acc, &k]() {
+                auto osc = Oscillator<Cubic>{1.f, wavetable, 440.f};
+                osc.setPhaseAccumulator(acc.accumulator);
+                return [osc, &k](float *out, std::size_t n) mutable {
+                    osc.fill(out, n, k.kernel);
+                };
+            };
+            std::cout << "  " << k.name << ": " << nsPerSample(frames, simd())
+                      << " ns/sample (max difference to scalar "
+                      << maxDifference(reference, render(frames, simd()))
+                      << ")\n";
+        }
+    }
+
+    benchBank(wavetable, frames);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+/*
+ *  SSE2 and AVX2 cubic interpolation kernels for the table lookup oscillator
+ */
+#include "cubic_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+// Index of y0 when the integer phase is zero. Mirrors the Cubic policy.
+static int wrappedY0Index(std::size_t size) { return (int)size - 1; }
+
+void cubicKernelScalar(const float *table, std::size_t size,
+                       const float *phases, float amplitude, float *out,
+                       std::size_t n)
+{
+    const int wrappedY0 = wrappedY0Index(size);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const float phase = phases[i];
+        const int index = (int)phase;
+        const float fraction = phase - index;
+        const float y0 = index > 0 ? table[index - 1] : table[wrappedY0];
+        const float y1 = table[index];
+        const float y2 = table[index + 1];
+        const float y3 = table[index + 2];
+        out[i] = amplitude * cubicInterpolate(y0, y1, y2, y3, fraction);
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+void cubicKernelSse2(const float *table, std::size_t size, const float *phases,
+                     float amplitude, float *out, std::size_t n)
+{
+    const __m128 amp = _mm_set1_ps(amplitude);
+    const __m128 three = _mm_set1_ps(3.f);
+    const __m128 minusTwo = _mm_set1_ps(-2.f);
+    const __m128 two = _mm_set1_ps(2.f);
+    const __m128 six = _mm_set1_ps(6.f);
+    const __m128 signBit = _mm_set1_ps(-0.f);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i wrapOffset = _mm_set1_epi32(wrappedY0Index(size) + 1);
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 phase = _mm_loadu_ps(phases + i);
+        const __m128i index = _mm_cvttps_epi32(phase);
+        const __m128 fraction = _mm_sub_ps(phase, _mm_cvtepi32_ps(index));
+
+        // index - 1, or the wrapped index where index is zero
+        const __m128i isZero = _mm_cmpeq_epi32(index, _mm_setzero_si128());
+        const __m128i index0 = _mm_add_epi32(_mm_sub_epi32(index, one),
+                                             _mm_and_si128(isZero, wrapOffset));
+
+        // SSE2 has no gather, so load the four taps of each lane by hand
+        alignas(16) int idx[4], idx0[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(idx), index);
+        _mm_store_si128(reinterpret_cast<__m128i *>(idx0), index0);
+        const __m128 y0 = _mm_setr_ps(table[idx0[0]], table[idx0[1]],
+                                      table[idx0[2]], table[idx0[3]]);
+        const __m128 y1 = _mm_setr_ps(table[idx[0]], table[idx[1]],
+                                      table[idx[2]], table[idx[3]]);
+        const __m128 y2 = _mm_setr_ps(table[idx[0] + 1], table[idx[1] + 1],
+                                      table[idx[2] + 1], table[idx[3] + 1]);
+        const __m128 y3 = _mm_setr_ps(table[idx[0] + 2], table[idx[1] + 2],
+                                      table[idx[2] + 2], table[idx[3] + 2]);
+
+        const __m128 tmp = _mm_add_ps(y3, _mm_mul_ps(three, y1));
+        const __m128 fractionSquared = _mm_mul_ps(fraction, fraction);
+        const __m128 fractionCubic = _mm_mul_ps(fraction, fractionSquared);
+
+        const __m128 negY0 = _mm_xor_ps(y0, signBit);
+        const __m128 c3 = _mm_div_ps(
+            _mm_mul_ps(fractionCubic,
+                       _mm_add_ps(_mm_sub_ps(negY0, _mm_mul_ps(three, y2)),
+                                  tmp)),
+            six);
+        const __m128 c2 = _mm_mul_ps(
+            fractionSquared,
+            _mm_sub_ps(_mm_div_ps(_mm_add_ps(y0, y2), two), y1));
+        const __m128 c1 = _mm_mul_ps(
+            fraction,
+            _mm_add_ps(y2, _mm_div_ps(_mm_sub_ps(_mm_mul_ps(minusTwo, y0), tmp),
+                                      six)));
+        const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(c3, c2), c1), y1);
+        _mm_storeu_ps(out + i, _mm_mul_ps(amp, sum));
+    }
+    cubicKernelScalar(table, size, phases + i, amplitude, out + i, n - i);
+}
+
+__attribute__((target("avx2"))) void
+cubicKernelAvx2(const float *table, std::size_t size, const float *phases,
+                float amplitude, float *out, std::size_t n)
+{
+    const __m256 amp = _mm256_set1_ps(amplitude);
+    const __m256 three = _mm256_set1_ps(3.f);
+    const __m256 minusTwo = _mm256_set1_ps(-2.f);
+    const __m256 two = _mm256_set1_ps(2.f);
+    const __m256 six = _mm256_set1_ps(6.f);
+    const __m256 signBit = _mm256_set1_ps(-0.f);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i wrapOffset = _mm256_set1_epi32(wrappedY0Index(size) + 1);
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 phase = _mm256_loadu_ps(phases + i);
+        const __m256i index = _mm256_cvttps_epi32(phase);
+        const __m256 fraction =
+            _mm256_sub_ps(phase, _mm256_cvtepi32_ps(index));
+
+        const __m256i isZero =
+            _mm256_cmpeq_epi32(index, _mm256_setzero_si256());
+        const __m256i index0 =
+            _mm256_add_epi32(_mm256_sub_epi32(index, one),
+                             _mm256_and_si256(isZero, wrapOffset));
+
+        const __m256 y0 = _mm256_i32gather_ps(table, index0, 4);
+        const __m256 y1 = _mm256_i32gather_ps(table, index, 4);
+        const __m256 y2 = _mm256_i32gather_ps(table + 1, index, 4);
+        const __m256 y3 = _mm256_i32gather_ps(table + 2, index, 4);
+
+        const __m256 tmp = _mm256_add_ps(y3, _mm256_mul_ps(three, y1));
+        const __m256 fractionSquared = _mm256_mul_ps(fraction, fraction);
+        const __m256 fractionCubic = _mm256_mul_ps(fraction, fractionSquared);
+
+        const __m256 negY0 = _mm256_xor_ps(y0, signBit);
+        const __m256 c3 = _mm256_div_ps(
+            _mm256_mul_ps(
+                fractionCubic,
+                _mm256_add_ps(_mm256_sub_ps(negY0, _mm256_mul_ps(three, y2)),
+                              tmp)),
+            six);
+        const __m256 c2 = _mm256_mul_ps(
+            fractionSquared,
+            _mm256_sub_ps(_mm256_div_ps(_mm256_add_ps(y0, y2), two), y1));
+        const __m256 c1 = _mm256_mul_ps(
+            fraction,
+            _mm256_add_ps(
+                y2, _mm256_div_ps(
+                        _mm256_sub_ps(_mm256_mul_ps(minusTwo, y0), tmp), six)));
+        const __m256 sum =
+            _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(c3, c2), c1), y1);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(amp, sum));
+    }
+    cubicKernelSse2(table, size, phases + i, amplitude, out + i, n - i);
+}
+
+static CubicKernel detectCubicKernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return cubicKernelAvx2;
+    return cubicKernelSse2;
+}
+
+CubicKernel bestCubicKernel()
+{
+    static const CubicKernel kernel = detectCubicKernel();
+    return kernel;
+}
+
+#else // Not x86: fall back to the scalar kernel
+
+void cubicKernelSse2(const float *table, std::size_t size, const float *phases,
+                     float amplitude, float *out, std::size_t n)
+{
+    cubicKernelScalar(table, size, phases, amplitude, out, n);
+}
+
+void cubicKernelAvx2(const float *table, std::size_t size, const float *phases,
+                     float amplitude, float *out, std::size_t n)
+{
+    cubicKernelScalar(table, size, phases, amplitude, out, n);
+}
+
+CubicKernel bestCubicKernel() { return cubicKernelScalar; }
+
+#endif
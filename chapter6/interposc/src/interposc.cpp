@@ -1,38 +1,72 @@
 /*
  *  Interpolating or truncating table lookup oscillator
  */
-#define _USE_MATH_DEFINES
+#include "analysis.hpp"
+#include "oscillator.hpp"
+#include "wavetable.hpp"
+#include "writer.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <deque>
+#include <future>
 #include <getopt.h>
 #include <iostream>
 #include <memory>
 #include <sndfile.h>
+#include <thread>
 #include <vector>
 
-constexpr int SAMPLE_RATE = 44100;
-constexpr int WAVETABLE_SIZE = 1024;
-constexpr int BUF_SIZE = 512;
-constexpr auto PI = M_PI;
+constexpr std::size_t DEFAULT_BLOCK_SIZE = 1 << 16;
+constexpr std::size_t MAX_BLOCK_SECONDS = 10; // Upper bound of -b
+constexpr std::size_t SEGMENT_FRAMES = 1 << 20; // Parallel work unit
 
 void usage()
 {
     std::cout <<
-        R"(interposc - linear, cubic or truncating table lookup oscillator
+        R"(interposc - interpolating or truncating table lookup oscillator
 
 SYNOPSIS
     ./interposc [OPTION] outfile duration frequency nharmonics
+    ./interposc -q SNR [OPTION] frequency
 
 OPTIONS:
     -a [0.0-1.0]
         Amplitude of generated tone (default = 1.0)
+    -b FRAMES
+        Block size, frames rendered while the previous blocks are being
+        written to disk, at most 10 seconds of frames (default = 65536)
     -h
         Display this help and exit
+    -J
+        Print analysis results as JSON
+    -j THREADS
+        Render in parallel on THREADS threads, 0 for one per core. Output is
+        identical to a serial render. Implies -p 1.
+    -m
+        Use band-limited wavetables, one per octave, so that no harmonic
+        exceeds Nyquist frequency. nharmonics is ignored.
+    -p PHASE
+        Phase accumulator:
+            0: float (default)
+            1: 32-bit fixed point, drift-free for long renders
+    -q SNR
+        Analyze instead of writing a file: render a sine at frequency with
+        every lookup type and table size (or the one given with -s), measure
+        SNR and THD against an ideal sine and the time taken, and print the
+        cheapest combination with at least SNR dB signal to noise ratio
+    -r RATE
+        Sample rate in Hz (default = 44100)
+    -s SIZE
+        Wavetable size in samples, 16 to 65536 (default = 1024). Powers
+        of two from 256 to 8192 are fastest.
     -t TYPE
         Table lookup type:
             0: truncating
             1: linear interpolation
             2: cubic interpolation (default)
+            3: 4-point Hermite interpolation
+            4: 8-point windowed sinc interpolation
     -w WAVE
         Waveform type. One of:
             0: sine (default)
@@ -41,191 +75,100 @@ OPTIONS:
             3: triangle
     )";
 }
-// TODO: split classes to multiple files
 
-enum class Waveform
-{
-    Sine,
-    Saw,
-    Square,
-    Triangle
-};
-
-enum class TableLookupType
-{
-    Truncating,
-    LinearInterpolation,
-    CubicInterpolation
-};
-
-template <typename Iter> void normalize(Iter begin, Iter end)
-{
-    auto peak = *std::max_element(begin, end);
-    auto scale = [peak](auto sample) { return sample * (1.0 / peak); };
-    std::transform(begin, end, begin, scale);
-}
-
-auto fourierTable(const std::vector<float> &harmonicAmplitudes,
-                  float phaseOffset)
-{
-    std::array<float, WAVETABLE_SIZE + 2> table;
-    table.fill(0.f);
-    phaseOffset *= (float)PI * 2;
-
-    for (auto i = 0ul; i < harmonicAmplitudes.size(); ++i)
-        for (auto n = 0ul; n < WAVETABLE_SIZE + 2; ++n)
-        {
-            auto a = harmonicAmplitudes.at(i);
-            auto w = (i + 1) * (n * 2 * PI / WAVETABLE_SIZE);
-            table[n] += (float)(a * cos(w + phaseOffset));
-        }
-    normalize(table.begin(), table.end());
-    return table;
-}
-
-class Wavetable
+/**
+ * Write frames samples of osc to outFile in blocks of blockSize. Blocks are
+ * written by a separate thread while the next one is being rendered.
+ * Instantiated once per lookup policy, so the render loop has no per-block
+ * dispatch.
+ */
+template <typename Lookup>
+std::size_t render(SNDFILE *outFile, Oscillator<Lookup> osc, std::size_t frames,
+                   std::size_t blockSize)
 {
-    std::array<float, WAVETABLE_SIZE + 2> table;
-
-  public:
-    Wavetable(Waveform waveform, int harmonics)
+    AsyncWriter writer{outFile, blockSize};
+    while (frames > 0)
     {
-        switch (waveform)
+        float *block = writer.acquire();
+        if (block == nullptr)
         {
-        case Waveform::Sine:
-        {
-            float phase = 0;
-            const auto incr = (float)2 * PI / WAVETABLE_SIZE;
-            for (int i = 0; i < WAVETABLE_SIZE + 2; ++i)
-            {
-                table[i] = sin(phase);
-                phase += incr;
-            }
-            break;
-        }
-        case Waveform::Saw:
-        {
-            std::vector<float> harmAmps(harmonics, 0.f);
-            for (int i = 0; i < harmonics; ++i)
-                harmAmps[i] = 1.f / (i + 1);
-            table = fourierTable(harmAmps, -0.25);
-            break;
-        }
-        case Waveform::Square:
-        {
-            std::vector<float> harmAmps(harmonics, 0.f);
-            for (int i = 0; i < harmonics; i += 2)
-                harmAmps[i] = 1.f / (i + 1);
-            table = fourierTable(harmAmps, -0.25);
+            std::cerr << "Error: failed to write output file\n";
             break;
         }
-        case Waveform::Triangle:
-        {
-            std::vector<float> harmAmps(harmonics, 0.f);
-            for (int i = 0; i < harmonics; i += 2)
-                harmAmps[i] = 1.f / ((i + 1) * (i + 1));
-            table = fourierTable(harmAmps, 0.0);
-        }
-        }
+        const auto n = std::min(blockSize, frames);
+        osc.fill(block, n);
+        writer.submit(n);
+        frames -= n;
     }
-    float operator[](const std::size_t idx) const { return table[idx]; }
-};
+    return writer.finish();
+}
 
-class Oscillator
+/**
+ * Write frames samples of osc to outFile, rendering segments of
+ * SEGMENT_FRAMES on up to threads worker threads. Every segment starts from
+ * a copy of osc advanced to the segment's first frame, so with the fixed
+ * point accumulator the output is bit-identical to render(). Segments are
+ * written in order while the following ones are being rendered.
+ */
+template <typename Lookup>
+std::size_t renderParallel(SNDFILE *outFile, const Oscillator<Lookup> &osc,
+                           std::size_t frames, unsigned threads)
 {
-    const Wavetable &wave; // Wavetable to sample from
-    float phase{0.0};      // Current phase of oscillator
-    const int sampleRate;
-
-  public:
-    float amplitude{1.0}, freq;
-    Oscillator(float amp, const Wavetable &w, float freq,
-               int srate = SAMPLE_RATE)
-        : wave(w), sampleRate(srate), amplitude(amp), freq(freq)
-    {
-    }
-
-    /**
-     * Fill given range with truncated lookup from oscillators wavetable
-     */
-    template <typename Iter> void fillTruncated(Iter begin, Iter end)
-    {
-        const auto increment = freq * WAVETABLE_SIZE / SAMPLE_RATE;
-        for (auto i = begin; i != end; ++i)
-        {
-            *i = amplitude * wave[(int)phase];
-            phase += increment;
-            // Modulus for float value
-            while (phase >= WAVETABLE_SIZE)
-                phase -= WAVETABLE_SIZE;
-            while (phase < 0)
-                phase += WAVETABLE_SIZE;
-        }
-    }
-
-    /**
-     * Fill given range with linear interpolation from oscillators wavetable
-     */
-    template <typename Iter> void fillLinearInterpolation(Iter begin, Iter end)
-    {
-        const auto increment = freq * WAVETABLE_SIZE / SAMPLE_RATE;
-        for (auto i = begin; i != end; ++i)
-        {
-            auto fraction = phase - (int)phase;
-            auto a = wave[(int)phase];
-            auto b = wave[(int)phase + 1];
-            *i = amplitude * (a + fraction * (b - a));
-            phase += increment;
-            // Modulus for float value
-            while (phase >= WAVETABLE_SIZE)
-                phase -= WAVETABLE_SIZE;
-            while (phase < 0)
-                phase += WAVETABLE_SIZE;
-        }
-    }
-
-    template <typename Iter> void fillCubicInterpolation(Iter begin, Iter end)
+    const auto segments = (frames + SEGMENT_FRAMES - 1) / SEGMENT_FRAMES;
+    auto launch = [&osc, frames](std::size_t segment) {
+        auto render = [copy = osc, frames, segment]() mutable {
+            const auto start = segment * SEGMENT_FRAMES;
+            std::vector<float> buf(std::min(SEGMENT_FRAMES, frames - start));
+            copy.advance(start);
+            copy.fill(buf.data(), buf.size());
+            return buf;
+        };
+        return std::async(std::launch::async, render);
+    };
+
+    std::deque<std::future<std::vector<float>>> pending;
+    std::size_t next = 0, totalFramesWritten = 0;
+    while (next < segments && pending.size() < threads)
+        pending.push_back(launch(next++));
+    while (!pending.empty())
     {
-        const auto increment = freq * WAVETABLE_SIZE / SAMPLE_RATE;
-        for (auto i = begin; i != end; ++i)
+        const auto buf = pending.front().get();
+        pending.pop_front();
+        if (next < segments)
+            pending.push_back(launch(next++));
+        auto framesWritten = sf_write_float(outFile, buf.data(), buf.size());
+        totalFramesWritten += framesWritten;
+        if ((std::size_t)framesWritten != buf.size())
         {
-            auto fraction = phase - (int)phase;
-            auto y0 = (int)phase > 0 ? wave[(int)phase - 1]
-                                     : wave[WAVETABLE_SIZE - 1 + 2];
-            auto y1 = wave[(int)phase];
-            auto y2 = wave[(int)phase + 1];
-            auto y3 = wave[(int)phase + 2];
-
-            auto tmp = y3 + 3 * y1;
-            auto fractionSquared = fraction * fraction;
-            auto fractionCubic = fraction * fractionSquared;
-
-            *i = amplitude * (fractionCubic * (-y0 - 3.f * y2 + tmp) / 6.f +
-                              fractionSquared * ((y0 + y2) / 2.f - y1) +
-                              fraction * (y2 + (-2.f * y0 - tmp) / 6.f) + y1);
-
-            phase += increment;
-            // Modulus for float value
-            while (phase >= WAVETABLE_SIZE)
-                phase -= WAVETABLE_SIZE;
-            while (phase < 0)
-                phase += WAVETABLE_SIZE;
+            std::cerr << "Error: failed to write output file\n";
+            break;
         }
     }
-};
+    return totalFramesWritten;
+}
 
 auto main(int argc, char const *argv[]) -> int
 {
-    std::vector<float> outBuf(BUF_SIZE, 0.f);
     auto outFileName = "./out.wav";
     TableLookupType tableLookup = TableLookupType::CubicInterpolation;
     auto waveform = Waveform::Sine;
+    auto accumulator = PhaseAccumulator::Float;
+    bool mipmapped = false;
+    unsigned threads = 1;
+    bool parallel = false; // -j given, which implies -p 1
+    std::size_t blockSize = DEFAULT_BLOCK_SIZE;
+    int sampleRate = DEFAULT_SAMPLE_RATE;
+    std::size_t tableSize = DEFAULT_WAVETABLE_SIZE;
+    bool tableSizeGiven = false;
+    bool analysis = false, json = false;
+    double targetSnr = 0.0;
     float amplitude = 1.f;
 
     // Parse arguments
 
     int c;
-    while ((c = getopt(argc, (char *const *)argv, "a:ht:w:")) != -1)
+    const char *options = "a:b:hJj:mp:q:r:s:t:w:";
+    while ((c = getopt(argc, (char *const *)argv, options)) != -1)
         switch (c)
         {
         case 'a':
@@ -241,12 +184,96 @@ auto main(int argc, char const *argv[]) -> int
             amplitude = a;
             break;
         }
+        case 'b':
+        {
+            long b = strtol(optarg, nullptr, 10);
+            if (b <= 0)
+            {
+                std::cerr << "Error: block size must be positive\n";
+                return EXIT_FAILURE;
+            }
+            blockSize = b;
+            break;
+        }
         case 'h':
         {
             usage();
             return EXIT_SUCCESS;
             break;
         }
+        case 'J':
+            json = true;
+            break;
+        case 'j':
+        {
+            long j = strtol(optarg, nullptr, 10);
+            if (j < 0)
+            {
+                std::cerr << "Error: thread count must be non-negative\n";
+                return EXIT_FAILURE;
+            }
+            threads =
+                j > 0 ? j : std::max(1u, std::thread::hardware_concurrency());
+            parallel = true;
+            break;
+        }
+        case 'm':
+            mipmapped = true;
+            break;
+        case 'p':
+        {
+            int p = strtol(optarg, nullptr, 10);
+            switch (p)
+            {
+            case static_cast<int>(PhaseAccumulator::Float):
+                accumulator = PhaseAccumulator::Float;
+                break;
+            case static_cast<int>(PhaseAccumulator::Fixed):
+                accumulator = PhaseAccumulator::Fixed;
+                break;
+            default:
+                std::cerr << "Error: invalid phase accumulator: " << p << "\n";
+                usage();
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case 'q':
+        {
+            targetSnr = strtod(optarg, nullptr);
+            if (std::isnan(targetSnr))
+            {
+                std::cerr << "Error: target SNR must be a number\n";
+                return EXIT_FAILURE;
+            }
+            analysis = true;
+            break;
+        }
+        case 'r':
+        {
+            long r = strtol(optarg, nullptr, 10);
+            if (r <= 0 || r > 1000000)
+            {
+                std::cerr << "Error: invalid sample rate\n";
+                return EXIT_FAILURE;
+            }
+            sampleRate = r;
+            break;
+        }
+        case 's':
+        {
+            long size = strtol(optarg, nullptr, 10);
+            if (size < (long)MIN_TABLE_SIZE || size > (long)MAX_TABLE_SIZE)
+            {
+                std::cerr << "Error: wavetable size must be between "
+                          << MIN_TABLE_SIZE << " and " << MAX_TABLE_SIZE
+                          << "\n";
+                return EXIT_FAILURE;
+            }
+            tableSize = size;
+            tableSizeGiven = true;
+            break;
+        }
         case 't':
         {
             int t = strtol(optarg, nullptr, 10);
@@ -261,6 +288,12 @@ auto main(int argc, char const *argv[]) -> int
             case static_cast<int>(TableLookupType::CubicInterpolation):
                 tableLookup = TableLookupType::CubicInterpolation;
                 break;
+            case static_cast<int>(TableLookupType::HermiteInterpolation):
+                tableLookup = TableLookupType::HermiteInterpolation;
+                break;
+            case static_cast<int>(TableLookupType::SincInterpolation):
+                tableLookup = TableLookupType::SincInterpolation;
+                break;
             default:
                 std::cerr << "Error: invalid table lookup type: " << t << "\n";
                 break;
@@ -305,6 +338,40 @@ auto main(int argc, char const *argv[]) -> int
             abort();
         }
 
+    // Three blocks are kept in memory, so bound them by the sample rate, which
+    // may be given after -b
+    const auto maxBlockSize =
+        std::max(DEFAULT_BLOCK_SIZE, MAX_BLOCK_SECONDS * sampleRate);
+    if (blockSize > maxBlockSize)
+    {
+        std::cerr << "Error: block size must be at most " << maxBlockSize
+                  << " frames (" << MAX_BLOCK_SECONDS << " seconds)\n";
+        return EXIT_FAILURE;
+    }
+
+    if (analysis)
+    {
+        if (argc - optind != 1)
+        {
+            std::cerr << "Error: invalid number of arguments\n";
+            usage();
+            return EXIT_FAILURE;
+        }
+        float frequency = strtod(argv[optind], nullptr);
+        if (!(frequency > 0 && frequency < sampleRate / 2.f))
+        {
+            std::cerr << "Error: frequency must be between 0 and Nyquist\n";
+            return EXIT_FAILURE;
+        }
+        const auto results = analyze(
+            frequency, sampleRate, accumulator,
+            tableSizeGiven ? std::vector<std::size_t>{tableSize}
+                           : ANALYSIS_TABLE_SIZES);
+        printAnalysis(std::cout, results, frequency, sampleRate, accumulator,
+                      targetSnr, json);
+        return cheapest(results, targetSnr) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     if (argc - optind != 4) // Check argument count
     {
         std::cerr << "Error: invalid number of arguments\n";
@@ -340,7 +407,7 @@ auto main(int argc, char const *argv[]) -> int
     // Initialize libsndfile and open file for output
 
     SF_INFO info = {};
-    info.samplerate = SAMPLE_RATE;
+    info.samplerate = sampleRate;
     info.channels = 1;
     info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
 
@@ -352,36 +419,55 @@ auto main(int argc, char const *argv[]) -> int
         return EXIT_FAILURE;
     }
 
-    // Initialize oscillator
-
-    auto wavtab = Wavetable{waveform, harmonics};
-    auto osc = Oscillator{amplitude, wavtab, frequency};
-
-    // Process
+    // Initialize oscillator and process
+
+    std::unique_ptr<Wavetable> wavtab;
+    if (!mipmapped)
+        wavtab.reset(new Wavetable{waveform, harmonics, tableSize});
+    const std::size_t frames = sampleRate * duration;
+    auto renderWith = [&](auto lookup) {
+        using Osc = Oscillator<decltype(lookup)>;
+        auto osc =
+            mipmapped
+                ? Osc{amplitude,
+                      WavetableSet::get(waveform, sampleRate, tableSize),
+                      frequency, sampleRate}
+                : Osc{amplitude, *wavtab, frequency, sampleRate};
+        // Only the fixed point phase can be computed in closed form. It is
+        // used with any -j, so that the output does not depend on the number
+        // of threads.
+        osc.setPhaseAccumulator(parallel ? PhaseAccumulator::Fixed
+                                         : accumulator);
+        if (threads > 1)
+            return renderParallel(outFile, osc, frames, threads);
+        return render(outFile, osc, frames, blockSize);
+    };
 
     size_t totalFramesWritten = 0;
-    size_t framesRemaining = SAMPLE_RATE * duration;
-    while (framesRemaining > 0)
+    const auto start = std::chrono::steady_clock::now();
+    switch (tableLookup)
     {
-        switch (tableLookup)
-        {
-        case TableLookupType::Truncating:
-            osc.fillTruncated(outBuf.begin(), outBuf.end());
-            break;
-        case TableLookupType::LinearInterpolation:
-            osc.fillLinearInterpolation(outBuf.begin(), outBuf.end());
-            break;
-        case TableLookupType::CubicInterpolation:
-            osc.fillCubicInterpolation(outBuf.begin(), outBuf.end());
-            break;
-        }
-        auto framesWritten = sf_write_float(
-            outFile, outBuf.data(), std::min(outBuf.size(), framesRemaining));
-        totalFramesWritten += framesWritten;
-        framesRemaining -= framesWritten;
+    case TableLookupType::Truncating:
+        totalFramesWritten = renderWith(Truncate{});
+        break;
+    case TableLookupType::LinearInterpolation:
+        totalFramesWritten = renderWith(Linear{});
+        break;
+    case TableLookupType::CubicInterpolation:
+        totalFramesWritten = renderWith(Cubic{});
+        break;
+    case TableLookupType::HermiteInterpolation:
+        totalFramesWritten = renderWith(Hermite{});
+        break;
+    case TableLookupType::SincInterpolation:
+        totalFramesWritten = renderWith(WindowedSinc{});
+        break;
     }
-    std::cout << totalFramesWritten << "frames written to " << outFileName
-              << "\n";
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << totalFramesWritten << " frames written to " << outFileName
+              << " in " << elapsed.count() << " seconds ("
+              << totalFramesWritten / elapsed.count() << " frames/s)\n";
 
     // Cleanup
 
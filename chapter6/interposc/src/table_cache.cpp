@@ -0,0 +1,139 @@
+/*
+ *  Memory mapped on-disk wavetable cache
+ */
+#include "table_cache.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Bump when table generation changes, so that stale cached tables are rebuilt
+constexpr std::uint32_t TABLE_GENERATOR = 1;
+constexpr std::uint32_t CACHE_VERSION = 1; // TABCACHE_VERSION of tabgen
+constexpr std::uint32_t SAMPLE_FLOAT32 = 0;
+
+struct CacheHeader
+{
+    char magic[4];
+    std::uint32_t version, generator, waveform, harmonics, length, guards,
+        sampleType;
+};
+static_assert(sizeof(CacheHeader) == 32, "cache header is 32 bytes");
+
+static CacheHeader makeHeader(const TableKey &key)
+{
+    return {{'W', 'T', 'A', 'B'}, CACHE_VERSION, TABLE_GENERATOR,
+            key.waveform,         key.harmonics, key.length,
+            key.guards,           SAMPLE_FLOAT32};
+}
+
+/**
+ * Cache directory, or an empty string if the cache is disabled
+ */
+static std::string cacheDir()
+{
+    const char *base = std::getenv("WAVETABLE_CACHE");
+    if (base)
+        return *base ? std::string(base) + "/interposc" : std::string();
+    if ((base = std::getenv("XDG_CACHE_HOME")) && *base)
+        return std::string(base) + "/audioprogramming/interposc";
+    if ((base = std::getenv("HOME")) && *base)
+        return std::string(base) + "/.cache/audioprogramming/interposc";
+    return std::string();
+}
+
+static std::string cachePath(const std::string &dir, const TableKey &key)
+{
+    return dir + "/" + std::to_string(key.waveform) + "-" +
+           std::to_string(key.harmonics) + "-" + std::to_string(key.length) +
+           "-" + std::to_string(key.guards) + "-f32.wtab";
+}
+
+/**
+ * Create dir and its parents
+ */
+static bool makeDirs(const std::string &dir)
+{
+    for (auto slash = dir.find('/', 1); slash != std::string::npos;
+         slash = dir.find('/', slash + 1))
+        if (mkdir(dir.substr(0, slash).c_str(), 0777) && errno != EEXIST)
+            return false;
+    return !mkdir(dir.c_str(), 0777) || errno == EEXIST;
+}
+
+static std::size_t fileSize(const TableKey &key)
+{
+    return sizeof(CacheHeader) +
+           (std::size_t{key.length} + key.guards) * sizeof(float);
+}
+
+std::shared_ptr<const float> loadCachedTable(const TableKey &key)
+{
+    const auto dir = cacheDir();
+    if (dir.empty())
+        return nullptr;
+    const int fd = open(cachePath(dir, key).c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    const auto size = fileSize(key);
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (std::size_t)st.st_size == size)
+        mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid
+    if (mapping == MAP_FAILED)
+        return nullptr;
+
+    // A stale or foreign file is ignored, and replaced on the next store
+    const auto header = makeHeader(key);
+    if (std::memcmp(mapping, &header, sizeof(header)) != 0)
+    {
+        munmap(mapping, size);
+        return nullptr;
+    }
+    std::shared_ptr<void> owner(mapping,
+                                [size](void *m) { munmap(m, size); });
+    return std::shared_ptr<const float>(
+        owner, reinterpret_cast<const float *>(
+                   static_cast<const char *>(mapping) + sizeof(header)));
+}
+
+bool storeCachedTable(const TableKey &key, const float *samples)
+{
+    const auto dir = cacheDir();
+    if (dir.empty() || !makeDirs(dir))
+        return false;
+    const auto path = cachePath(dir, key);
+    std::string tmpPath = path + ".XXXXXX";
+    const int fd = mkstemp(&tmpPath[0]);
+    if (fd < 0)
+        return false;
+
+    const auto header = makeHeader(key);
+    const auto dataSize = fileSize(key) - sizeof(header);
+    auto writeAll = [fd](const void *data, std::size_t n) {
+        auto bytes = static_cast<const char *>(data);
+        while (n > 0)
+        {
+            const auto written = write(fd, bytes, n);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            bytes += written;
+            n -= written;
+        }
+        return true;
+    };
+    bool ok = writeAll(&header, sizeof(header)) && writeAll(samples, dataSize);
+    ok = close(fd) == 0 && ok;
+    ok = ok && rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!ok)
+        unlink(tmpPath.c_str());
+    return ok;
+}
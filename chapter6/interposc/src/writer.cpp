@@ -0,0 +1,69 @@
+/*
+ *  Sound file writer thread
+ */
+#include "writer.hpp"
+
+AsyncWriter::AsyncWriter(SNDFILE *file, std::size_t blockSize,
+                         std::size_t nblocks)
+    : file(file), blocks(nblocks, std::vector<float>(blockSize, 0.f))
+{
+    for (std::size_t i = 0; i < nblocks; ++i)
+        freeBlocks.push_back(i);
+    writer = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() { finish(); }
+
+void AsyncWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [this] { return finished || !filled.empty(); });
+        if (filled.empty())
+            return; // finished and drained
+        const auto block = filled.front();
+        filled.pop_front();
+
+        lock.unlock();
+        const auto written =
+            sf_write_float(file, blocks[block.first].data(), block.second);
+        lock.lock();
+
+        framesWritten += written;
+        if ((std::size_t)written != block.second)
+            failed = true;
+        freeBlocks.push_back(block.first);
+        changed.notify_all();
+    }
+}
+
+float *AsyncWriter::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return failed || !freeBlocks.empty(); });
+    if (failed)
+        return nullptr;
+    current = freeBlocks.front();
+    freeBlocks.pop_front();
+    return blocks[current].data();
+}
+
+void AsyncWriter::submit(std::size_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    filled.emplace_back(current, length);
+    changed.notify_all();
+}
+
+std::size_t AsyncWriter::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        changed.notify_all();
+    }
+    if (writer.joinable())
+        writer.join();
+    return framesWritten;
+}